@@ -186,6 +186,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 
 #define MZ_ASSERT(x) assert(x)
 
@@ -1,5 +1,7 @@
 #include "TLFXAnimImage.h"
 
+#include <cstring>
+
 namespace TLFX
 {
 
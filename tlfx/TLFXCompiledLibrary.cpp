@@ -0,0 +1,784 @@
+#include "TLFXCompiledLibrary.h"
+#include "TLFXEffectsLibrary.h"
+#include "TLFXAnimImage.h"
+#include "TLFXEffect.h"
+#include "TLFXEmitter.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace TLFX
+{
+
+    namespace
+    {
+        // ---- file layout, every offset is from the start of the file
+
+        const char     magic[4]  = { 'T', 'L', 'F', 'X' };
+        const uint32_t byteOrder = 0x01020304;
+        const int      maxDepth  = 64;      // of effects inside emitters inside effects...
+
+        const char *importOptions[] = { "GREYSCALE", "FULLCOLOR", "PASSTHROUGH" };
+
+        struct FileHeader
+        {
+            char        magic[4];
+            uint32_t    version;
+            uint32_t    byteOrder;
+            uint32_t    size;                           // of the whole file
+            float       lookupFrequency;                // the tables were compiled with
+            float       lookupFrequencyOverTime;
+            uint32_t    tableStride;
+            uint32_t    shapeCount, shapes;             // ShapeRecord[shapeCount]
+            uint32_t    effectCount, effects;           // uint32_t[effectCount] offsets of EffectRecords
+            uint32_t    superEffectCount, superEffects; // same for the super effects
+        };
+
+        struct ShapeRecord
+        {
+            uint32_t    filename, name;                 // strings
+            float       width, height, maxRadius;
+            int32_t     frames, index, importOpt;
+        };
+
+        struct NodeRecord
+        {
+            float       frame, value;
+            float       c0x, c0y, c1x, c1y;
+            uint32_t    isCurve;
+        };
+
+        struct ArrayRecord
+        {
+            uint32_t    nodeCount, nodes;               // NodeRecord[nodeCount]
+            uint32_t    changeCount, changes;           // float[changeCount], 16 bytes aligned
+            int32_t     life;
+            uint32_t    compiled;
+        };
+
+        enum EffectFlags
+        {
+            EffectSuper             = 1 << 0,
+            EffectEmitAtPoints      = 1 << 1,
+            EffectLockAspect        = 1 << 2,
+            EffectHandleCenter      = 1 << 3,
+            EffectTraverseEdge      = 1 << 4,
+            EffectDistanceSetByLife = 1 << 5,
+            EffectReverseSpawn      = 1 << 6,
+            EffectLooped            = 1 << 7,
+        };
+
+        struct EffectRecord
+        {
+            uint32_t    name, path;
+            uint32_t    flags;
+            int32_t     type, mgx, mgy, emissionType, effectLength, handleX, handleY, endBehavior;
+            int32_t     frames, animWidth, animHeight, animX, animY, seed, frameOffset;
+            float       ellipseArc, zoom;
+            ArrayRecord arrays[Effect::arrayCount];
+            uint32_t    childCount, children;           // offsets of the EmitterRecords, or of the grouped EffectRecords of a super effect
+        };
+
+        enum EmitterFlags
+        {
+            EmitterImage             = 1 << 0,
+            EmitterParticlesRelative = 1 << 1,
+            EmitterRandomColor       = 1 << 2,
+            EmitterSingleParticle    = 1 << 3,
+            EmitterAnimate           = 1 << 4,
+            EmitterOnce              = 1 << 5,
+            EmitterRandomStartFrame  = 1 << 6,
+            EmitterUniform           = 1 << 7,
+            EmitterLockAngle         = 1 << 8,
+            EmitterAngleRelative     = 1 << 9,
+            EmitterUseEffectEmission = 1 << 10,
+            EmitterOneShot           = 1 << 11,
+            EmitterHandleCenter      = 1 << 12,
+            EmitterGroupParticles    = 1 << 13,
+        };
+
+        struct EmitterRecord
+        {
+            uint32_t    name, path;
+            uint32_t    flags;
+            int32_t     handleX, handleY, blendMode, zLayer, animationDirection, angleType, angleOffset, colorRepeat, alphaRepeat;
+            int32_t     image;                          // index of the shape, if EmitterImage
+            float       currentFrame;
+            ArrayRecord arrays[Emitter::arrayCount];
+            uint32_t    tableRowCount, tableRows;       // float[tableRowCount * EmitterTable::stride], 64 bytes aligned, no rows if the table wasn't compiled
+            int32_t     tableLife;
+            uint32_t    tableConstant;
+            uint32_t    effectCount, effects;           // offsets of the EffectRecords of the sub effects
+        };
+
+        // ---- writing
+
+        class Writer
+        {
+        public:
+            std::vector<char> data;
+
+            uint32_t Reserve(size_t size, size_t align = 4)
+            {
+                data.resize((data.size() + align - 1) / align * align, 0);
+                uint32_t offset = (uint32_t)data.size();
+                data.resize(data.size() + size, 0);
+                return offset;
+            }
+
+            uint32_t Append(const void *p, size_t size, size_t align = 4)
+            {
+                uint32_t offset = Reserve(size, align);
+                if (size)
+                    memcpy(&data[offset], p, size);
+                return offset;
+            }
+
+            template <typename T> void Patch(uint32_t offset, const T& record)
+            {
+                memcpy(&data[offset], &record, sizeof(T));
+            }
+
+            uint32_t String(const char *s)
+            {
+                auto it = _strings.find(s);
+                if (it != _strings.end())
+                    return it->second;
+                uint32_t offset = Append(s, strlen(s) + 1, 1);
+                _strings[s] = offset;
+                return offset;
+            }
+
+        protected:
+            std::map<std::string, uint32_t> _strings;
+        };
+
+        void SaveArray(Writer& w, const EmitterArray *a, ArrayRecord& r)
+        {
+            const std::vector<AttributeNode>& attributes = a->GetAttributes();
+            std::vector<NodeRecord> nodes;
+            for (auto it = attributes.begin(); it != attributes.end(); ++it)
+            {
+                NodeRecord n = { it->frame, it->value, it->c0x, it->c0y, it->c1x, it->c1y, it->isCurve ? 1u : 0u };
+                nodes.push_back(n);
+            }
+            r.nodeCount = (uint32_t)nodes.size();
+            r.nodes = w.Append(nodes.data(), nodes.size() * sizeof(NodeRecord));
+
+            r.compiled = a->IsCompiled() ? 1 : 0;
+            r.changeCount = r.compiled ? a->GetLastFrame() + 1 : 0;
+            r.changes = w.Append(a->GetCompiledData(), r.changeCount * sizeof(float), 16);
+            r.life = a->GetLife();
+        }
+
+        uint32_t SaveEffect(Writer& w, Effect *e);
+
+        uint32_t SaveEmitter(Writer& w, Emitter *e)
+        {
+            uint32_t offset = w.Reserve(sizeof(EmitterRecord));
+            EmitterRecord r;
+            memset(&r, 0, sizeof(r));
+
+            r.name = w.String(e->GetName());
+            r.path = w.String(e->GetPath());
+            r.flags = (e->GetImage()            ? EmitterImage : 0)
+                    | (e->IsParticlesRelative() ? EmitterParticlesRelative : 0)
+                    | (e->IsRandomColor()       ? EmitterRandomColor : 0)
+                    | (e->IsSingleParticle()    ? EmitterSingleParticle : 0)
+                    | (e->IsAnimate()           ? EmitterAnimate : 0)
+                    | (e->IsOnce()              ? EmitterOnce : 0)
+                    | (e->IsRandomStartFrame()  ? EmitterRandomStartFrame : 0)
+                    | (e->IsUniform()           ? EmitterUniform : 0)
+                    | (e->IsLockAngle()         ? EmitterLockAngle : 0)
+                    | (e->IsAngleRelative()     ? EmitterAngleRelative : 0)
+                    | (e->IsUseEffectEmission() ? EmitterUseEffectEmission : 0)
+                    | (e->IsOneShot()           ? EmitterOneShot : 0)
+                    | (e->IsHandleCenter()      ? EmitterHandleCenter : 0)
+                    | (e->IsGroupParticles()    ? EmitterGroupParticles : 0);
+            r.handleX = e->GetHandleX();
+            r.handleY = e->GetHandleY();
+            r.blendMode = e->GetBlendMode();
+            r.zLayer = e->GetZLayer();
+            r.animationDirection = e->GetAnimationDirection();
+            r.angleType = e->GetAngleType();
+            r.angleOffset = e->GetAngleOffset();
+            r.colorRepeat = e->GetColorRepeat();
+            r.alphaRepeat = e->GetAlphaRepeat();
+            r.image = e->GetImage() ? e->GetImage()->GetIndex() : 0;
+            r.currentFrame = e->GetCurrentFrame();
+
+            EmitterArray *arrays[Emitter::arrayCount];
+            e->GetArrays(arrays);
+            for (int i = 0; i < Emitter::arrayCount; ++i)
+                SaveArray(w, arrays[i], r.arrays[i]);
+
+            const EmitterTable *table = e->GetTable();
+            if (table->IsCurrent())
+            {
+                r.tableRowCount = table->GetLastRow() + 1;
+                r.tableRows = w.Append(table->GetRow(0), r.tableRowCount * EmitterTable::stride * sizeof(float), EmitterTable::stride * sizeof(float));
+                r.tableLife = table->GetLife();
+                for (int c = 0; c < EmitterTable::ColumnCount; ++c)
+                {
+                    if (table->IsConstant((EmitterTable::Column)c))
+                        r.tableConstant |= 1u << c;
+                }
+            }
+
+            std::vector<uint32_t> effects;
+            const std::list<Effect*>& subEffects = e->GetEffects();
+            for (auto it = subEffects.begin(); it != subEffects.end(); ++it)
+                effects.push_back(SaveEffect(w, *it));
+            r.effectCount = (uint32_t)effects.size();
+            r.effects = w.Append(effects.data(), effects.size() * sizeof(uint32_t));
+
+            w.Patch(offset, r);
+            return offset;
+        }
+
+        uint32_t SaveEffect(Writer& w, Effect *e)
+        {
+            uint32_t offset = w.Reserve(sizeof(EffectRecord));
+            EffectRecord r;
+            memset(&r, 0, sizeof(r));
+
+            r.name = w.String(e->GetName());
+            r.path = w.String(e->GetPath());
+            r.flags = (e->IsSuper()               ? EffectSuper : 0)
+                    | (e->GetEmitAtPoints()       ? EffectEmitAtPoints : 0)
+                    | (e->GetLockAspect()         ? EffectLockAspect : 0)
+                    | (e->GetHandleCenter()       ? EffectHandleCenter : 0)
+                    | (e->GetTraverseEdge()       ? EffectTraverseEdge : 0)
+                    | (e->GetDistanceSetByLife()  ? EffectDistanceSetByLife : 0)
+                    | (e->GetReverseSpawn()       ? EffectReverseSpawn : 0)
+                    | (e->GetLooped()             ? EffectLooped : 0);
+            r.type = e->GetClass();
+            r.mgx = e->GetMGX();
+            r.mgy = e->GetMGY();
+            r.emissionType = e->GetEmissionType();
+            r.effectLength = e->GetEffectLength();
+            r.handleX = e->GetHandleX();
+            r.handleY = e->GetHandleY();
+            r.endBehavior = e->GetEndBehavior();
+            r.frames = e->GetFrames();
+            r.animWidth = e->GetAnimWidth();
+            r.animHeight = e->GetAnimHeight();
+            r.animX = e->GetAnimX();
+            r.animY = e->GetAnimY();
+            r.seed = e->GetSeed();
+            r.frameOffset = e->GetFrameOffset();
+            r.ellipseArc = e->GetEllipseArc();
+            r.zoom = e->GetZoom();
+
+            EmitterArray *arrays[Effect::arrayCount];
+            e->GetArrays(arrays);
+            for (int i = 0; i < Effect::arrayCount; ++i)
+                SaveArray(w, arrays[i], r.arrays[i]);
+
+            std::vector<uint32_t> children;
+            if (e->IsSuper())
+            {
+                std::vector<Effect*>& grouped = e->GetEffects();
+                for (auto it = grouped.begin(); it != grouped.end(); ++it)
+                    children.push_back(SaveEffect(w, *it));
+            }
+            else
+            {
+                const Entity::ChildList& emitters = e->GetChildren();
+                for (auto it = emitters.begin(); it != emitters.end(); ++it)
+                    children.push_back(SaveEmitter(w, static_cast<Emitter*>(*it)));
+            }
+            r.childCount = (uint32_t)children.size();
+            r.children = w.Append(children.data(), children.size() * sizeof(uint32_t));
+
+            w.Patch(offset, r);
+            return offset;
+        }
+
+        // ---- loading
+
+        // delete an effect that couldn't be loaded entirely, it isn't in a library yet
+        void DeleteEffect(Effect *e)
+        {
+            if (e->IsSuper())
+            {
+                std::vector<Effect*>& grouped = e->GetEffects();
+                for (auto it = grouped.begin(); it != grouped.end(); ++it)
+                    DeleteEffect(*it);
+            }
+            const Entity::ChildList& emitters = e->GetChildren();
+            for (auto it = emitters.begin(); it != emitters.end(); ++it)
+            {
+                Emitter *emitter = static_cast<Emitter*>(*it);
+                const std::list<Effect*>& subEffects = emitter->GetEffects();
+                for (auto sub = subEffects.begin(); sub != subEffects.end(); ++sub)
+                    DeleteEffect(*sub);
+                delete emitter;
+            }
+            delete e;
+        }
+    }
+
+    CompiledLibrary::CompiledLibrary( int shapes /*= 0*/ )
+        : XMLLoader(shapes)
+        , _data(NULL)
+        , _size(0)
+        , _nextShape(0)
+        , _nextEffect(0)
+        , _nextSuperEffect(0)
+        , _precompiled(false)
+    {
+        _error[0] = 0;
+    }
+
+    CompiledLibrary::~CompiledLibrary()
+    {
+    }
+
+    bool CompiledLibrary::Open( const char *filename )
+    {
+        _error[0] = 0;
+
+        // aligned like a mapping for the tables when the file has to be read
+        if (!_file.Open(filename, EmitterTable::stride * sizeof(float)))
+        {
+            snprintf(_error, sizeof(_error), "%s", _file.GetLastError());
+            _data = NULL;
+            _size = 0;
+            return false;
+        }
+        _data = _file.GetData();
+        _size = _file.GetSize();
+
+        const FileHeader *h = (const FileHeader*)At(0, sizeof(FileHeader));
+        if (!h || memcmp(h->magic, magic, sizeof(magic)) != 0)
+        {
+            snprintf(_error, sizeof(_error), "%s is not a compiled library", filename);
+            return false;
+        }
+        if (h->byteOrder != byteOrder)
+        {
+            snprintf(_error, sizeof(_error), "%s was compiled for another byte order", filename);
+            return false;
+        }
+        if (h->version != formatVersion || h->tableStride != (uint32_t)EmitterTable::stride)
+        {
+            snprintf(_error, sizeof(_error), "%s is in format version %u, expected %u", filename, h->version, formatVersion);
+            return false;
+        }
+        if (h->size != _size)
+        {
+            snprintf(_error, sizeof(_error), "%s is truncated", filename);
+            return false;
+        }
+        if (!At(h->shapes, sizeof(ShapeRecord), h->shapeCount) || !At(h->effects, sizeof(uint32_t), h->effectCount) ||
+            !At(h->superEffects, sizeof(uint32_t), h->superEffectCount))
+        {
+            snprintf(_error, sizeof(_error), "%s is corrupted", filename);
+            return false;
+        }
+
+        _precompiled = h->lookupFrequency == EffectsLibrary::GetLookupFrequency() &&
+                       h->lookupFrequencyOverTime == EffectsLibrary::GetLookupFrequencyOverTime();
+        _nextShape = _nextEffect = _nextSuperEffect = 0;
+        return true;
+    }
+
+    const char* CompiledLibrary::GetLastError() const
+    {
+        return _error;
+    }
+
+    const void* CompiledLibrary::At( unsigned int offset, unsigned int size, unsigned int count /*= 1*/ ) const
+    {
+        if (offset % sizeof(uint32_t) != 0 || (unsigned long long)offset + (unsigned long long)size * count > _size)
+            return NULL;
+        return _data + offset;
+    }
+
+    const char* CompiledLibrary::String( unsigned int offset ) const
+    {
+        if (offset >= _size || !memchr(_data + offset, 0, _size - offset))
+            return NULL;
+        return _data + offset;
+    }
+
+    bool CompiledLibrary::GetNextShape( AnimImage *shape )
+    {
+        _error[0] = 0;
+
+        const FileHeader *h = (const FileHeader*)_data;
+        if (_nextShape >= h->shapeCount)
+        {
+            snprintf(_error, sizeof(_error), "No more shapes there");
+            return false;
+        }
+
+        const ShapeRecord *r = (const ShapeRecord*)At(h->shapes, sizeof(ShapeRecord), h->shapeCount) + _nextShape;
+        const char *filename = String(r->filename), *name = String(r->name);
+        if (!filename || !name || r->importOpt < 0 || r->importOpt >= (int)(sizeof(importOptions) / sizeof(importOptions[0])))
+        {
+            snprintf(_error, sizeof(_error), "Shape #%u is corrupted", _nextShape);
+            return false;
+        }
+
+        shape->SetFilename   (filename);
+        shape->SetName       (name);
+        shape->SetImportOpt  (importOptions[r->importOpt]);
+        shape->SetWidth      (r->width);
+        shape->SetHeight     (r->height);
+        shape->SetFramesCount(r->frames);
+        shape->SetIndex      (r->index + _existingShapeCount);
+
+        if (r->maxRadius != 0)
+            shape->SetMaxRadius(r->maxRadius);
+        else
+            shape->FindRadius();
+
+        ++_nextShape;
+        return true;
+    }
+
+    void CompiledLibrary::LocateEffect()
+    {
+        _nextEffect = 0;
+    }
+
+    void CompiledLibrary::LocateSuperEffect()
+    {
+        _nextSuperEffect = 0;
+    }
+
+    Effect* CompiledLibrary::GetNextEffect( const std::list<AnimImage*>& sprites )
+    {
+        const FileHeader *h = (const FileHeader*)_data;
+        if (_nextEffect >= h->effectCount)
+        {
+            snprintf(_error, sizeof(_error), "No more effects there");
+            return NULL;
+        }
+
+        const uint32_t *effects = (const uint32_t*)At(h->effects, sizeof(uint32_t), h->effectCount);
+        Effect *effect = LoadEffect(effects[_nextEffect++], sprites, NULL, 0);
+        if (effect && !_precompiled)
+            effect->CompileAll();
+        return effect;
+    }
+
+    Effect* CompiledLibrary::GetNextSuperEffect( const std::list<AnimImage*>& sprites )
+    {
+        const FileHeader *h = (const FileHeader*)_data;
+        if (_nextSuperEffect >= h->superEffectCount)
+        {
+            snprintf(_error, sizeof(_error), "No more super effects there");
+            return NULL;
+        }
+
+        const uint32_t *superEffects = (const uint32_t*)At(h->superEffects, sizeof(uint32_t), h->superEffectCount);
+        Effect *superEffect = LoadEffect(superEffects[_nextSuperEffect++], sprites, NULL, 0);
+        if (superEffect && !_precompiled)
+            superEffect->CompileAll();
+        return superEffect;
+    }
+
+    bool CompiledLibrary::IndexEffects( std::vector<std::string>& effects, std::vector<std::string>& superEffects )
+    {
+        const FileHeader *h = (const FileHeader*)_data;
+        const uint32_t *offsets[2] = { (const uint32_t*)At(h->effects, sizeof(uint32_t), h->effectCount),
+                                       (const uint32_t*)At(h->superEffects, sizeof(uint32_t), h->superEffectCount) };
+        unsigned int counts[2] = { h->effectCount, h->superEffectCount };
+        std::vector<std::string> *paths[2] = { &effects, &superEffects };
+        for (int t = 0; t < 2; ++t)
+        {
+            for (unsigned int i = 0; i < counts[t]; ++i)
+            {
+                const EffectRecord *r = (const EffectRecord*)At(offsets[t][i], sizeof(EffectRecord));
+                const char *path = r ? String(r->path) : NULL;
+                if (!path)
+                {
+                    snprintf(_error, sizeof(_error), "Effect at %u is corrupted", offsets[t][i]);
+                    return false;
+                }
+                _index[path] = offsets[t][i];
+                paths[t]->push_back(path);
+            }
+        }
+        return true;
+    }
+
+    Effect* CompiledLibrary::LoadIndexedEffect( const char *path, const std::list<AnimImage*>& sprites )
+    {
+        auto it = _index.find(path);
+        if (it == _index.end())
+        {
+            snprintf(_error, sizeof(_error), "No effect %s there", path);
+            return NULL;
+        }
+
+        Effect *effect = LoadEffect(it->second, sprites, NULL, 0);
+        if (effect && !_precompiled)
+            effect->CompileAll();
+        return effect;
+    }
+
+    Effect* CompiledLibrary::LoadEffect( unsigned int offset, const std::list<AnimImage*>& sprites, Emitter *parent, int depth )
+    {
+        const EffectRecord *r = (const EffectRecord*)At(offset, sizeof(EffectRecord));
+        const uint32_t *children = r ? (const uint32_t*)At(r->children, sizeof(uint32_t), r->childCount) : NULL;
+        const char *name = r ? String(r->name) : NULL, *path = r ? String(r->path) : NULL;
+        if (!children || !name || !path || depth > maxDepth)
+        {
+            snprintf(_error, sizeof(_error), "Effect at %u is corrupted", offset);
+            return NULL;
+        }
+
+        Effect *e = new Effect();
+
+        if (r->flags & EffectSuper)
+            e->MakeSuper();
+        e->SetClass            ((Effect::Type)r->type);
+        e->SetEmitAtPoints     ((r->flags & EffectEmitAtPoints) != 0);
+        e->SetMGX              (r->mgx);
+        e->SetMGY              (r->mgy);
+        e->SetEmissionType     ((Effect::Emission)r->emissionType);
+        e->SetEllipseArc       (r->ellipseArc);
+        e->SetEffectLength     (r->effectLength);
+        e->SetLockAspect       ((r->flags & EffectLockAspect) != 0);
+        e->SetName             (name);
+        e->SetHandleCenter     ((r->flags & EffectHandleCenter) != 0);
+        e->SetHandleX          (r->handleX);
+        e->SetHandleY          (r->handleY);
+        e->SetTraverseEdge     ((r->flags & EffectTraverseEdge) != 0);
+        e->SetEndBehavior      ((Effect::End)r->endBehavior);
+        e->SetDistanceSetByLife((r->flags & EffectDistanceSetByLife) != 0);
+        e->SetReverseSpawn     ((r->flags & EffectReverseSpawn) != 0);
+        e->SetParentEmitter(parent);
+        e->SetPath(path);
+
+        e->SetFrames     (r->frames);
+        e->SetAnimWidth  (r->animWidth);
+        e->SetAnimHeight (r->animHeight);
+        e->SetAnimX      (r->animX);
+        e->SetAnimY      (r->animY);
+        e->SetSeed       (r->seed);
+        e->SetLooped     ((r->flags & EffectLooped) != 0);
+        e->SetZoom       (r->zoom);
+        e->SetFrameOffset(r->frameOffset);
+
+        bool loaded = true;
+        EmitterArray *arrays[Effect::arrayCount];
+        e->GetArrays(arrays);
+        for (int i = 0; loaded && i < Effect::arrayCount; ++i)
+            loaded = LoadArray(&r->arrays[i], arrays[i]);
+
+        for (unsigned int i = 0; loaded && i < r->childCount; ++i)
+        {
+            if (e->IsSuper())
+            {
+                Effect *subEffect = LoadEffect(children[i], sprites, parent, depth + 1);
+                if ((loaded = subEffect != NULL))
+                {
+                    subEffect->SetParent(e);
+                    e->AddGroupedEffect(subEffect);
+                }
+            }
+            else
+            {
+                Emitter *emitter = LoadEmitter(children[i], sprites, e, depth + 1);
+                if ((loaded = emitter != NULL))
+                    e->AddChild(emitter);
+            }
+        }
+
+        if (!loaded)
+        {
+            DeleteEffect(e);
+            return NULL;
+        }
+        return e;
+    }
+
+    Emitter* CompiledLibrary::LoadEmitter( unsigned int offset, const std::list<AnimImage*>& sprites, Effect *parent, int depth )
+    {
+        const EmitterRecord *r = (const EmitterRecord*)At(offset, sizeof(EmitterRecord));
+        const uint32_t *effects = r ? (const uint32_t*)At(r->effects, sizeof(uint32_t), r->effectCount) : NULL;
+        const char *name = r ? String(r->name) : NULL, *path = r ? String(r->path) : NULL;
+        if (!effects || !name || !path)
+        {
+            snprintf(_error, sizeof(_error), "Emitter at %u is corrupted", offset);
+            return NULL;
+        }
+
+        Emitter *e = new Emitter;
+
+        e->SetHandleX           (r->handleX);
+        e->SetHandleY           (r->handleY);
+        e->SetBlendMode         ((Entity::BlendMode)r->blendMode);
+        e->SetParticlesRelative ((r->flags & EmitterParticlesRelative) != 0);
+        e->SetRandomColor       ((r->flags & EmitterRandomColor) != 0);
+        e->SetZLayer            (r->zLayer);
+        e->SetSingleParticle    ((r->flags & EmitterSingleParticle) != 0);
+        e->SetName              (name);
+        e->SetAnimate           ((r->flags & EmitterAnimate) != 0);
+        e->SetOnce              ((r->flags & EmitterOnce) != 0);
+        e->SetCurrentFrame      (r->currentFrame);
+        e->SetRandomStartFrame  ((r->flags & EmitterRandomStartFrame) != 0);
+        e->SetAnimationDirection(r->animationDirection);
+        e->SetUniform           ((r->flags & EmitterUniform) != 0);
+        e->SetAngleType         ((Emitter::Angle)r->angleType);
+        e->SetAngleOffset       (r->angleOffset);
+        e->SetLockAngle         ((r->flags & EmitterLockAngle) != 0);
+        e->SetAngleRelative     ((r->flags & EmitterAngleRelative) != 0);
+        e->SetUseEffectEmission ((r->flags & EmitterUseEffectEmission) != 0);
+        e->SetColorRepeat       (r->colorRepeat);
+        e->SetAlphaRepeat       (r->alphaRepeat);
+        e->SetOneShot           ((r->flags & EmitterOneShot) != 0);
+        e->SetHandleCenter      ((r->flags & EmitterHandleCenter) != 0);
+        e->SetGroupParticles    ((r->flags & EmitterGroupParticles) != 0);
+
+        e->SetParentEffect(parent);
+        e->SetPath(path);
+
+        if (r->flags & EmitterImage)
+        {
+            AnimImage *image = GetSpriteInList(sprites, r->image + _existingShapeCount);
+            if (image)
+                e->SetImage(image);
+        }
+
+        bool loaded = true;
+        EmitterArray *arrays[Emitter::arrayCount];
+        e->GetArrays(arrays);
+        for (int i = 0; loaded && i < Emitter::arrayCount; ++i)
+            loaded = LoadArray(&r->arrays[i], arrays[i]);
+
+        if (loaded && _precompiled && r->tableRowCount)
+        {
+            const unsigned int rowSize = EmitterTable::stride * sizeof(float);
+            const float *rows = (const float*)At(r->tableRows, rowSize, r->tableRowCount);
+            if ((loaded = rows != NULL && r->tableRows % rowSize == 0))
+            {
+                const EmitterArray *columns[EmitterTable::ColumnCount];
+                e->GetTableColumns(columns);
+                e->GetTable()->SetRows(rows, r->tableRowCount, r->tableLife, r->tableConstant, columns);
+            }
+        }
+
+        for (unsigned int i = 0; loaded && i < r->effectCount; ++i)
+        {
+            Effect *subEffect = LoadEffect(effects[i], sprites, e, depth + 1);
+            if ((loaded = subEffect != NULL))
+                e->AddEffect(subEffect);
+        }
+
+        if (!loaded)
+        {
+            snprintf(_error, sizeof(_error), "Emitter at %u is corrupted", offset);
+            const std::list<Effect*>& subEffects = e->GetEffects();
+            for (auto it = subEffects.begin(); it != subEffects.end(); ++it)
+                DeleteEffect(*it);
+            delete e;
+            return NULL;
+        }
+
+        if (_precompiled)
+            e->AnalyseEmitter();
+        return e;
+    }
+
+    bool CompiledLibrary::LoadArray( const void *record, EmitterArray *a )
+    {
+        const ArrayRecord *r = (const ArrayRecord*)record;
+        const NodeRecord *nodes = (const NodeRecord*)At(r->nodes, sizeof(NodeRecord), r->nodeCount);
+        if (!nodes)
+            return false;
+
+        for (unsigned int i = 0; i < r->nodeCount; ++i)
+        {
+            AttributeNode *attr = a->Add(nodes[i].frame, nodes[i].value);
+            attr->isCurve = nodes[i].isCurve != 0;
+            attr->c0x = nodes[i].c0x;
+            attr->c0y = nodes[i].c0y;
+            attr->c1x = nodes[i].c1x;
+            attr->c1y = nodes[i].c1y;
+        }
+
+        if (r->compiled && _precompiled)
+        {
+            const float *changes = (const float*)At(r->changes, sizeof(float), r->changeCount);
+            if (!changes || !r->changeCount)
+                return false;
+            a->SetCompiledData(changes, r->changeCount, r->life);
+        }
+        return true;
+    }
+
+    AnimImage* CompiledLibrary::GetSpriteInList( const std::list<AnimImage*>& sprites, int index ) const
+    {
+        for (auto s = sprites.begin(); s != sprites.end(); ++s)
+        {
+            if ((*s)->GetIndex() == index)
+                return *s;
+        }
+        return NULL;
+    }
+
+    bool CompiledLibrary::Save( const char *filename, const std::list<AnimImage*>& shapes, const std::vector<Effect*>& effects, const std::vector<Effect*>& superEffects )
+    {
+        Writer w;
+        uint32_t header = w.Reserve(sizeof(FileHeader));
+        FileHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, magic, sizeof(magic));
+        h.version = formatVersion;
+        h.byteOrder = byteOrder;
+        h.lookupFrequency = EffectsLibrary::GetLookupFrequency();
+        h.lookupFrequencyOverTime = EffectsLibrary::GetLookupFrequencyOverTime();
+        h.tableStride = EmitterTable::stride;
+
+        std::vector<ShapeRecord> shapeRecords;
+        for (auto it = shapes.begin(); it != shapes.end(); ++it)
+        {
+            const AnimImage *s = *it;
+            ShapeRecord r;
+            r.filename = w.String(s->GetFilename());
+            r.name = w.String(s->GetName());
+            r.width = s->GetWidth();
+            r.height = s->GetHeight();
+            r.maxRadius = s->GetMaxRadius();
+            r.frames = s->GetFramesCount();
+            r.index = s->GetIndex();
+            r.importOpt = s->GetImportOpt();
+            shapeRecords.push_back(r);
+        }
+        h.shapeCount = (uint32_t)shapeRecords.size();
+        h.shapes = w.Append(shapeRecords.data(), shapeRecords.size() * sizeof(ShapeRecord));
+
+        std::vector<uint32_t> offsets;
+        for (auto it = effects.begin(); it != effects.end(); ++it)
+            offsets.push_back(SaveEffect(w, *it));
+        h.effectCount = (uint32_t)offsets.size();
+        h.effects = w.Append(offsets.data(), offsets.size() * sizeof(uint32_t));
+
+        offsets.clear();
+        for (auto it = superEffects.begin(); it != superEffects.end(); ++it)
+            offsets.push_back(SaveEffect(w, *it));
+        h.superEffectCount = (uint32_t)offsets.size();
+        h.superEffects = w.Append(offsets.data(), offsets.size() * sizeof(uint32_t));
+
+        w.Reserve(0);
+        h.size = (uint32_t)w.data.size();
+        w.Patch(header, h);
+
+        FILE *f = fopen(filename, "wb");
+        if (!f)
+            return false;
+        bool written = fwrite(&w.data[0], 1, w.data.size(), f) == w.data.size();
+        return fclose(f) == 0 && written;
+    }
+
+} // namespace TLFX
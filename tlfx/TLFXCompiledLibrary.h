@@ -0,0 +1,92 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_COMPILEDLIBRARY_H
+#define _TLFX_COMPILEDLIBRARY_H
+
+#include "TLFXXMLLoader.h"
+#include "TLFXMappedFile.h"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace TLFX
+{
+
+    class EmitterArray;
+    class EffectsLibrary;
+
+    /**
+     * Precompiled effects library
+     * <p>A compiled library is a binary snapshot of a loaded EffectsLibrary: the shapes, the effects and emitters with their attribute nodes and,
+     * unlike the xml, the lookup tables Effect::CompileAll builds from them. It's written by #Save (see EffectsLibrary::SaveCompiled and the
+     * tlfx-compile tool) and read by EffectsLibrary::LoadCompiled.</p>
+     * <p>All the references in the file are offsets from its start, so the file is used where it's mapped in memory: the compiled arrays and
+     * emitter tables of the loaded effects point straight into the mapping (see EmitterArray::SetCompiledData), nothing is parsed or compiled.
+     * The library therefore has to stay open as long as the effects it loaded are alive, EffectsLibrary keeps it until EffectsLibrary::ClearAll.</p>
+     * <p>The tables are only valid for the lookup frequencies they were compiled with; when EffectsLibrary uses other ones the effects are
+     * compiled again from their attribute nodes. Files are in the byte order of the machine that wrote them and are refused by the others.</p>
+     */
+    class CompiledLibrary : public XMLLoader
+    {
+    public:
+        static const unsigned int formatVersion = 1;
+
+        CompiledLibrary(int shapes = 0);
+        virtual ~CompiledLibrary();
+
+        virtual bool        Open(const char *filename);
+        virtual bool        GetNextShape(AnimImage *shape);
+        virtual Effect*     GetNextEffect(const std::list<AnimImage*>& sprites);
+        virtual Effect*     GetNextSuperEffect(const std::list<AnimImage*>& sprites);
+        virtual void        LocateEffect();
+        virtual void        LocateSuperEffect();
+
+        virtual bool        IndexEffects(std::vector<std::string>& effects, std::vector<std::string>& superEffects);
+        virtual Effect*     LoadIndexedEffect(const char *path, const std::list<AnimImage*>& sprites);
+
+        virtual const char* GetLastError() const;
+
+        /**
+         * Whether the tables of the file are used as they are, or the effects have to be compiled again
+         */
+        bool IsPrecompiled() const { return _precompiled; }
+
+        /**
+         * Save the shapes and effects of a library
+         * @param effects The top level effects, sub effects are saved with their emitters
+         * @param superEffects The super effects, with the effects they group
+         */
+        static bool Save(const char *filename, const std::list<AnimImage*>& shapes, const std::vector<Effect*>& effects, const std::vector<Effect*>& superEffects);
+
+    protected:
+        MappedFile  _file;
+        const char *_data;                  // the mapped file
+        size_t      _size;
+
+        unsigned int _nextShape;
+        unsigned int _nextEffect;
+        unsigned int _nextSuperEffect;
+        bool         _precompiled;
+
+        std::map<std::string, unsigned int> _index;    // offsets of the effects and super effects by path, for LoadIndexedEffect
+
+        char _error[128];
+
+        const void* At(unsigned int offset, unsigned int size, unsigned int count = 1) const;
+        const char* String(unsigned int offset) const;
+
+        Effect*     LoadEffect(unsigned int offset, const std::list<AnimImage*>& sprites, Emitter *parent, int depth);
+        Emitter*    LoadEmitter(unsigned int offset, const std::list<AnimImage*>& sprites, Effect *parent, int depth);
+        bool        LoadArray(const void *record, EmitterArray *a);
+        AnimImage*  GetSpriteInList(const std::list<AnimImage*>& sprites, int index) const;
+
+        CompiledLibrary(const CompiledLibrary&);
+        CompiledLibrary& operator=(const CompiledLibrary&);
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_COMPILEDLIBRARY_H
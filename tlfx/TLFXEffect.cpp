@@ -52,6 +52,7 @@ namespace TLFX
         , _animX(0)
         , _animY(0)
         , _seed(0)
+        , _random(0)
         , _zoom(1.0f)
         , _frameOffset(0)
 
@@ -90,6 +91,9 @@ namespace TLFX
         , _arrayOwner(true)
         
         , _isSuper(false)
+
+        , _template(NULL)
+        , _pooled(false)
     {
         _inUse.resize(10);
 
@@ -112,106 +116,14 @@ namespace TLFX
 
     Effect::Effect( const Effect& o, ParticleManager* pm, bool copyDirectory /*= false*/ )
         : Entity(o)
-        
-        , _class(o._class)
-        , _currentEffectFrame(o._currentEffectFrame)
-        , _handleCenter(o._handleCenter)
-        , _source(o._source)
-        , _lockAspect(o._lockAspect)
-        , _particlesCreated(o._particlesCreated)
-        , _suspendTime(o._suspendTime)
-        , _gx(o._gx)
-        , _gy(o._gy)
-        , _mgx(o._mgx)
-        , _mgy(o._mgy)
-        , _emitAtPoints(o._emitAtPoints)
-        , _emissionType(o._emissionType)
-        , _effectLength(o._effectLength)
-        , _parentEmitter(o._parentEmitter)
-        , _spawnAge(o._spawnAge)
-        , _index(o._index)
-        , _particleCount(o._particleCount)
-        , _idleTime(o._idleTime)
-        , _traverseEdge(o._traverseEdge)
-        , _endBehavior(o._endBehavior)
-        , _distanceSetByLife(o._distanceSetByLife)
-        , _reverseSpawn(o._reverseSpawn)
-        , _spawnDirection(o._spawnDirection)
-        , _dying(o._dying)
-        , _allowSpawning(o._allowSpawning)
-        , _ellipseArc(o._ellipseArc)
-        , _ellipseOffset(o._ellipseOffset)
-        , _effectLayer(o._effectLayer)
-        , _doesNotTimeout(o._doesNotTimeout)
-
-        , _particleManager(pm)
-
-        , _frames(o._frames)
-        , _animWidth(o._animWidth)
-        , _animHeight(o._animHeight)
-        , _looped(o._looped)
-        , _animX(o._animX)
-        , _animY(o._animY)
-        , _seed(o._seed)
-        , _zoom(o._zoom)
-        , _frameOffset(o._frameOffset)
-
-        , _currentLife(o._currentLife)
-        , _currentAmount(o._currentAmount)
-        , _currentSizeX(o._currentSizeX)
-        , _currentSizeY(o._currentSizeY)
-        , _currentVelocity(o._currentVelocity)
-        , _currentSpin(o._currentSpin)
-        , _currentWeight(o._currentWeight)
-        , _currentWidth(o._currentWidth)
-        , _currentHeight(o._currentHeight)
-        , _currentAlpha(o._currentAlpha)
-        , _currentEmissionAngle(o._currentEmissionAngle)
-        , _currentEmissionRange(o._currentEmissionRange)
-        , _currentStretch(o._currentStretch)
-        , _currentGlobalZ(o._currentGlobalZ)
-
-        , _overrideSize(o._overrideSize)
-        , _overrideEmissionAngle(o._overrideEmissionAngle)
-        , _overrideEmissionRange(o._overrideEmissionRange)
-        , _overrideAngle(o._overrideAngle)
-        , _overrideLife(o._overrideLife)
-        , _overrideAmount(o._overrideAmount)
-        , _overrideVelocity(o._overrideVelocity)
-        , _overrideSpin(o._overrideSpin)
-        , _overrideSizeX(o._overrideSizeX)
-        , _overrideSizeY(o._overrideSizeY)
-        , _overrideWeight(o._overrideWeight)
-        , _overrideAlpha(o._overrideAlpha)
-        , _overrideStretch(o._overrideStretch)
-        , _overrideGlobalZ(o._overrideGlobalZ)
-
-        , _bypassWeight(o._overrideWeight)
-
         , _path(o._path)
-
-        , _arrayOwner(false)                // this copy (instance) is not owner
-        , _cLife(o._cLife)                  // copy the links to the templates
-        , _cAmount(o._cAmount)
-        , _cSizeX(o._cSizeX)
-        , _cSizeY(o._cSizeY)
-        , _cVelocity(o._cVelocity)
-        , _cWeight(o._cWeight)
-        , _cSpin(o._cSpin)
-        , _cAlpha(o._cAlpha)
-        , _cEmissionAngle(o._cEmissionAngle)
-        , _cEmissionRange(o._cEmissionRange)
-        , _cWidth(o._cWidth)
-        , _cHeight(o._cHeight)
-        , _cEffectAngle(o._cEffectAngle)
-        , _cStretch(o._cStretch)
-        , _cGlobalZ(o._cGlobalZ)
-        
-        , _isSuper(o._isSuper)
+        , _particleManager(pm)
+        , _pooled(false)
 
         // copy automatically: base/entity
         // not copy: Directories, inUse
     {
+        Assign(o);
         _inUse.resize(10);
 
         SetEllipseArc(o._ellipseArc);
@@ -245,8 +157,159 @@ namespace TLFX
         }
     }
 
+    void Effect::Assign( const Effect& o )
+    {
+        _class = o._class;
+        _currentEffectFrame = o._currentEffectFrame;
+        _handleCenter = o._handleCenter;
+        _source = o._source;
+        _lockAspect = o._lockAspect;
+        _particlesCreated = o._particlesCreated;
+        _suspendTime = o._suspendTime;
+        _gx = o._gx;
+        _gy = o._gy;
+        _mgx = o._mgx;
+        _mgy = o._mgy;
+        _emitAtPoints = o._emitAtPoints;
+        _emissionType = o._emissionType;
+        _effectLength = o._effectLength;
+        _parentEmitter = o._parentEmitter;
+        _spawnAge = o._spawnAge;
+        _index = o._index;
+        _particleCount = o._particleCount;
+        _idleTime = o._idleTime;
+        _traverseEdge = o._traverseEdge;
+        _endBehavior = o._endBehavior;
+        _distanceSetByLife = o._distanceSetByLife;
+        _reverseSpawn = o._reverseSpawn;
+        _spawnDirection = o._spawnDirection;
+        _dying = o._dying;
+        _allowSpawning = o._allowSpawning;
+        _ellipseArc = o._ellipseArc;
+        _ellipseOffset = o._ellipseOffset;
+        _effectLayer = o._effectLayer;
+        _doesNotTimeout = o._doesNotTimeout;
+
+        _frames = o._frames;
+        _animWidth = o._animWidth;
+        _animHeight = o._animHeight;
+        _looped = o._looped;
+        _animX = o._animX;
+        _animY = o._animY;
+        _seed = o._seed;
+        _random.Seed(o._seed);
+        _zoom = o._zoom;
+        _frameOffset = o._frameOffset;
+
+        _currentLife = o._currentLife;
+        _currentAmount = o._currentAmount;
+        _currentSizeX = o._currentSizeX;
+        _currentSizeY = o._currentSizeY;
+        _currentVelocity = o._currentVelocity;
+        _currentSpin = o._currentSpin;
+        _currentWeight = o._currentWeight;
+        _currentWidth = o._currentWidth;
+        _currentHeight = o._currentHeight;
+        _currentAlpha = o._currentAlpha;
+        _currentEmissionAngle = o._currentEmissionAngle;
+        _currentEmissionRange = o._currentEmissionRange;
+        _currentStretch = o._currentStretch;
+        _currentGlobalZ = o._currentGlobalZ;
+
+        _overrideSize = o._overrideSize;
+        _overrideEmissionAngle = o._overrideEmissionAngle;
+        _overrideEmissionRange = o._overrideEmissionRange;
+        _overrideAngle = o._overrideAngle;
+        _overrideLife = o._overrideLife;
+        _overrideAmount = o._overrideAmount;
+        _overrideVelocity = o._overrideVelocity;
+        _overrideSpin = o._overrideSpin;
+        _overrideSizeX = o._overrideSizeX;
+        _overrideSizeY = o._overrideSizeY;
+        _overrideWeight = o._overrideWeight;
+        _overrideAlpha = o._overrideAlpha;
+        _overrideStretch = o._overrideStretch;
+        _overrideGlobalZ = o._overrideGlobalZ;
+
+        _bypassWeight = o._overrideWeight;
+
+        _arrayOwner = false;                // this copy (instance) is not owner
+        _cLife = o._cLife;                  // copy the links to the templates
+        _cAmount = o._cAmount;
+        _cSizeX = o._cSizeX;
+        _cSizeY = o._cSizeY;
+        _cVelocity = o._cVelocity;
+        _cWeight = o._cWeight;
+        _cSpin = o._cSpin;
+        _cAlpha = o._cAlpha;
+        _cEmissionAngle = o._cEmissionAngle;
+        _cEmissionRange = o._cEmissionRange;
+        _cWidth = o._cWidth;
+        _cHeight = o._cHeight;
+        _cEffectAngle = o._cEffectAngle;
+        _cStretch = o._cStretch;
+        _cGlobalZ = o._cGlobalZ;
+
+        _isSuper = o._isSuper;
+
+        _template = o.GetTemplate();
+    }
+
+    void Effect::SetPooled()
+    {
+        _pooled = true;
+        _childrenOwner = false;             // see _emitters
+        _emitters.clear();
+        for (auto it = _children.begin(); it != _children.end(); ++it)
+        {
+            Emitter *e = static_cast<Emitter*>(*it);
+            e->_pooled = true;
+            _emitters.push_back(e);
+        }
+    }
+
+    bool Effect::Reuse( const Effect& o )
+    {
+        assert(_pooled && _children.empty());
+
+        if (_isSuper || o._isSuper || _emitters.size() != o._children.size())
+            return false;
+
+        base::Assign(o);
+        Assign(o);
+        SetEllipseArc(o._ellipseArc);
+        _dob = _particleManager->GetCurrentTime();
+        SetOKtoRender(false);
+
+        int i = 0;
+        for (auto it = o._children.begin(); it != o._children.end(); ++it, ++i)
+        {
+            Emitter *e = _emitters[i];
+            e->Reuse(*static_cast<Emitter*>(*it), _particleManager);
+            e->SetParentEffect(this);
+            e->SetParent(this);
+        }
+        return true;
+    }
+
+    void Effect::Dispose()
+    {
+        if (_pooled)
+            _particleManager->ReleaseEffect(this);
+        else
+            delete this;
+    }
+
     Effect::~Effect()
     {
+        if (_pooled)
+        {
+            for (auto it = _emitters.begin(); it != _emitters.end(); ++it)
+            {
+                delete *it;
+            }
+        }
+
         if (_arrayOwner)
         {
             delete _cLife;
@@ -531,6 +594,7 @@ namespace TLFX
     void Effect::SetSeed( int seed )
     {
         _seed = seed;
+        _random.Seed(seed);
     }
 
     void Effect::SetZoom( float zoom )
@@ -1079,13 +1143,12 @@ namespace TLFX
         _directoryEmitters.clear();
         for (int i = 0; i < 10; ++i)
         {
-            int c=0;while (!_inUse[i].empty())
+            while (!_inUse[i].empty())
             {
-                Particle *p = *_inUse[i].begin();
+                Particle *p = _inUse[i].front();
                 p->Reset();
                 _particleManager->ReleaseParticle(p);
                 RemoveInUse(i, p);
-                ++c;
             }
             _inUse[i].clear(); // should be already clear (RemoveInUse erases the items)
         }
@@ -1151,6 +1214,17 @@ namespace TLFX
         }
     }
 
+    void Effect::GetArrays( EmitterArray* arrays[arrayCount] ) const
+    {
+        EmitterArray* const all[arrayCount] =
+        {
+            _cLife, _cAmount, _cSizeX, _cSizeY, _cVelocity, _cWeight, _cSpin, _cAlpha, _cEmissionAngle, _cEmissionRange,
+            _cWidth, _cHeight, _cEffectAngle, _cStretch, _cGlobalZ
+        };
+        for (int i = 0; i < arrayCount; ++i)
+            arrays[i] = all[i];
+    }
+
     void Effect::CompileAmount()
     {
         _cAmount->Compile();
@@ -1313,21 +1387,29 @@ namespace TLFX
         }
     }
 
+    void Effect::FastForwardParticles()
+    {
+        // Emitter
+        for (auto it = _children.begin(); it != _children.end(); ++it)
+        {
+            Emitter* e = static_cast<Emitter*>(*it);
+            e->FastForwardParticles();
+        }
+    }
+
     void Effect::AddInUse( int layer, Particle *p )
     {
         assert(layer >= 0 && layer < (int)_inUse.size());
 
         // the particle is managed by this Effect
         SetGroupParticles(true);
-		_inUse[layer].push_back(p);
-		p->SetIter(--_inUse[layer].end());
+        _inUse[layer].push_back(p);
     }
 
     void Effect::RemoveInUse( int layer, Particle *p )
-	{
-		auto it = p->GetIter();
-        assert(layer >= 0 && layer < (int)_inUse.size() && it != _inUse[layer].end());
-		_inUse[layer].erase(it);
+    {
+        assert(layer >= 0 && layer < (int)_inUse.size() && _inUse[layer].contains(p));
+        _inUse[layer].erase(p);
     }
 
     int Effect::GetEffectLayer() const
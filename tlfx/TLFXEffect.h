@@ -60,13 +60,14 @@
 #define _TLFX_EFFECT_H
 
 #include "TLFXEntity.h"
+#include "TLFXParticle.h"
 #include "TLFXAttributeNode.h"
 #include "TLFXEmitterArray.h"
+#include "TLFXRandom.h"
 
 #include <string>
 #include <map>
 #include <vector>
-#include <list>
 
 namespace TLFX
 {
@@ -74,8 +75,6 @@ namespace TLFX
     class Particle;
     class ParticleManager;
     class Shape;
-	
-	typedef std::list<Particle*> ParticleList;
 
     class Effect : public Entity
     {
@@ -403,7 +402,8 @@ namespace TLFX
 
         /**
          * Sets the random seed for the effect animation
-         * Currently only relevant to the Timeline Particles editor
+         * <p>Restarts the random number generator of the effect, the emitters draw all their random values from it, so the same seed
+         * gives the same animation. 0 means no seed: #ParticleManager::AddEffect then picks one with rand().</p>
          */
         void SetSeed(int seed);
 
@@ -664,6 +664,11 @@ namespace TLFX
          */
         int GetSeed() const;
 
+        /**
+         * Get the random number generator the emitters of the effect use
+         */
+        Random& GetRandom() { return _random; }
+
         /**
          * Get the current zoom factor of the animation
          */
@@ -766,6 +771,11 @@ namespace TLFX
          */
         virtual bool Update();
 
+        /**
+         * Bring the particles of a fast-forward preload up to date, see Emitter::FastForwardParticles
+         */
+        void FastForwardParticles();
+
         /**
          * Softly kill an effect
          * Call this to kill an effect by stopping it from spawning any more particles. This will make the effect slowly die about as any remaining 
@@ -799,6 +809,17 @@ namespace TLFX
 
         virtual void Destroy(bool releaseChildren = true);
 
+        /**
+         * Free the effect, or give it back to its particle manager if it was taken from the pool (see ParticleManager::GrabEffect)
+         */
+        virtual void Dispose();
+
+        /**
+         * Get the effect of the library this one was copied from
+         * @return The effect itself if it is not a copy
+         */
+        const Effect* GetTemplate() const { return _template ? _template : this; }
+
         // Compilers
 
         // Pre-Compile all attributes.
@@ -807,6 +828,13 @@ namespace TLFX
         void CompileAll();
         void CompileQuick();
 
+        static const int arrayCount = 15;
+
+        /**
+         * Get the attribute arrays of the effect, always in the same order (the one CompiledLibrary saves them in)
+         */
+        void GetArrays(EmitterArray* arrays[arrayCount]) const;
+
         void CompileAmount();
         void CompileLife();
         void CompileSizeX();
@@ -926,6 +954,7 @@ namespace TLFX
         int                            _animX;                  /// the x offset from the center of the animation
         int                            _animY;                  /// the y offset from the center of the animation
         int                            _seed;                   /// the number used for the random number generator
+        Random                         _random;                 /// the random number generator, seeded with _seed
         float                          _zoom;                   /// level of zoom of the animation
         int                            _frameOffset;            /// Starting frame offset
 
@@ -981,6 +1010,29 @@ namespace TLFX
         
         bool                           _isSuper;            // Super effects are used to group other effects together. they don't container emitters.
         std::vector<Effect*>           _effects;            // The list to contain the super effects list
+
+        const Effect*                  _template;           // the library effect this one is a copy of, NULL in the library
+        bool                           _pooled;             // taken from the pool of the particle manager, which keeps it when it dies
+        std::vector<Emitter*>          _emitters;           // all the emitters of a pooled effect, dead or alive, it owns them
+
+        friend class ParticleManager;                       // the pool
+
+        /**
+         * Copy the settings of another effect, like the copy constructor but without the path, the emitters and the sub effects
+         */
+        void Assign(const Effect& o);
+
+        /**
+         * Make the effect and its emitters poolable, they are kept when they die
+         */
+        void SetPooled();
+
+        /**
+         * Restart a dead pooled effect as a copy of the effect passed to it
+         * The emitters are restarted in place, the names and the sub effects of the emitters are not copied again. This only works with copies of the same library effect.
+         * @return false if the effect passed to it doesn't have the same emitters
+         */
+        bool Reuse(const Effect& o);
     };
 
 } // namespace TLFX
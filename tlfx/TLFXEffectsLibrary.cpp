@@ -2,8 +2,10 @@
 #include "TLFXEffect.h"
 #include "TLFXEmitter.h"
 #include "TLFXAnimImage.h"
+#include "TLFXCompiledLibrary.h"
 
 #include <cassert>
+#include <cstring>
 
 namespace TLFX
 {
@@ -96,20 +98,92 @@ EffectsLibrary::~EffectsLibrary()
     ClearAll();
 }
 
-bool EffectsLibrary::Load( const char *filename, bool compile /*= true*/ )
+bool EffectsLibrary::Load( const char *filename, bool compile /*= true*/, bool lazy /*= false*/ )
 {
     XMLLoader *loader = CreateLoader();
+    bool indexed;
+    bool loaded = Load(loader, filename, compile, lazy, indexed);
+    if (indexed)
+        _loaders.push_back(loader);
+    else
+        delete loader;
+    return loaded;
+}
+
+bool EffectsLibrary::LoadCompiled( const char *filename, bool lazy /*= false*/ )
+{
+    CompiledLibrary *compiled = new CompiledLibrary((int)_shapeList.size());
+    bool indexed;
+    if (!Load(compiled, filename, false, lazy, indexed))
+    {
+        TLFXLOG(TLFX, ("[EffectsLibrary] Cannot load %s: %s", filename, compiled->GetLastError()));
+        delete compiled;
+        return false;
+    }
+    _loaders.push_back(compiled);
+    return true;
+}
+
+bool EffectsLibrary::SaveCompiled( const char *filename )
+{
+    // everything is saved, including what wasn't loaded yet
+    for (auto it = _index.begin(); it != _index.end(); ++it)
+    {
+        if (!it->second.loaded)
+            LoadIndexedEffect(it->first.c_str());
+    }
+
+    std::vector<Effect*> effects, superEffects;
+    for (auto it = _effects_names.begin(); it != _effects_names.end(); ++it)
+    {
+        Effect *effect = GetEffect(it->c_str());
+        if (effect && !effect->GetParentEmitter())      // sub effects are saved by their emitters
+            effects.push_back(effect);
+    }
+    for (auto it = _effects.begin(); it != _effects.end(); ++it)
+    {
+        if (it->second && it->second->IsSuper())
+            superEffects.push_back(it->second);
+    }
+    return CompiledLibrary::Save(filename, _shapeList, effects, superEffects);
+}
+
+bool EffectsLibrary::Load( XMLLoader *loader, const char *filename, bool compile, bool lazy, bool& indexed )
+{
+    indexed = false;
+
     bool loaded;
     if ((loaded = loader->Open(filename)))
     {
+        std::vector<std::string> effects, superEffects;
+        indexed = lazy && loader->IndexEffects(effects, superEffects);
+
         AnimImage *shape;
         while ((shape = CreateImage()), loader->GetNextShape(shape))
         {
-            if (!AddSprite(shape))
+            if (!AddSprite(shape, !indexed))
                 goto end;
         }
         delete shape; // last even shape is safe to delete
 
+        if (indexed)
+        {
+            // the effects are loaded by GetEffect
+            IndexedEffect entry = { loader, false, compile, false };
+            for (auto it = effects.begin(); it != effects.end(); ++it)
+            {
+                if (_index.find(*it) == _index.end() && _effects.find(*it) == _effects.end())
+                    _effects_names.push_back(*it);
+                _index[*it] = entry;
+            }
+            entry.super = true;
+            for (auto it = superEffects.begin(); it != superEffects.end(); ++it)
+                _index[*it] = entry;
+
+            _name = filename;
+            goto end;
+        }
+
         // try to locate an effect in xml doc
         loader->LocateEffect();
  
@@ -141,10 +215,107 @@ bool EffectsLibrary::Load( const char *filename, bool compile /*= true*/ )
     }
 
 end:
-    delete loader;
     return loaded;
 }
 
+bool EffectsLibrary::LoadIndexedEffect( const char *name )
+{
+    // the effect itself, or the top level effect it's a sub effect or emitter of: "Folder/Effect/Emitter/Sub effect"
+    std::string path = name;
+    auto it = _index.find(path);
+    for (size_t slash = 0; it == _index.end() && (slash = path.find('/', slash)) != std::string::npos; ++slash)
+        it = _index.find(path.substr(0, slash));
+    if (it == _index.end() || it->second.loaded)
+        return false;
+
+    IndexedEffect& entry = it->second;
+    Effect *effect = entry.loader->LoadIndexedEffect(it->first.c_str(), _shapeList);
+    if (!effect)
+    {
+        TLFXLOG(TLFX, ("[EffectsLibrary] Cannot load %s: %s", it->first.c_str(), entry.loader->GetLastError()));
+        return false;
+    }
+    entry.loaded = true;
+
+    if (entry.compile)
+        effect->CompileAll();
+    LoadShapes(effect);
+
+    // AllEffects doesn't change, it may be iterated while getting the effects: the sub effects aren't listed
+    size_t listed = _effects_names.size();
+    if (entry.super)
+        AddSuperEffect(effect);
+    else
+        AddEffect(effect);
+    _effects_names.resize(listed);
+    return true;
+}
+
+void EffectsLibrary::LoadShapes( Effect *effect )
+{
+    if (effect->IsSuper())
+    {
+        std::vector<Effect*>& grouped = effect->GetEffects();
+        for (auto it = grouped.begin(); it != grouped.end(); ++it)
+            LoadShapes(*it);
+    }
+
+    const Entity::ChildList& emitters = effect->GetChildren();
+    for (auto it = emitters.begin(); it != emitters.end(); ++it)
+    {
+        Emitter *emitter = static_cast<Emitter*>(*it);
+        AnimImage *image = emitter->GetImage();
+        if (image && _unloadedShapes.erase(image) && !image->Load())
+        {
+            TLFXLOG(TLFX, ("[EffectsLibrary] Cannot load %s", image->GetFilename()));
+        }
+
+        const std::list<Effect*>& subEffects = emitter->GetEffects();
+        for (auto sub = subEffects.begin(); sub != subEffects.end(); ++sub)
+            LoadShapes(*sub);
+    }
+}
+
+bool EffectsLibrary::UnloadEffect( const char *name )
+{
+    auto it = _index.find(name);
+    if (it == _index.end() || !it->second.loaded)
+        return false;
+
+    auto effect = _effects.find(name);
+    if (effect != _effects.end() && effect->second)
+        ReleaseEffect(effect->second, !it->second.super);
+    it->second.loaded = false;
+    return true;
+}
+
+void EffectsLibrary::ReleaseEffect( Effect *effect, bool inLibrary )
+{
+    // the entries of the library stay, empty, so that loading the effect again doesn't list its sub effects and emitters twice
+    if (effect->IsSuper())
+    {
+        std::vector<Effect*>& grouped = effect->GetEffects();
+        for (auto it = grouped.begin(); it != grouped.end(); ++it)
+            ReleaseEffect(*it, false);
+    }
+
+    const Entity::ChildList& emitters = effect->GetChildren();
+    for (auto it = emitters.begin(); it != emitters.end(); ++it)
+    {
+        Emitter *emitter = static_cast<Emitter*>(*it);
+        const std::list<Effect*>& subEffects = emitter->GetEffects();
+        for (auto sub = subEffects.begin(); sub != subEffects.end(); ++sub)
+            ReleaseEffect(*sub, inLibrary);
+        if (inLibrary)
+            _emitters[emitter->GetPath()] = NULL;
+        delete emitter;
+    }
+
+    if (inLibrary || effect->IsSuper())
+        _effects[effect->GetPath()] = NULL;
+    delete effect;
+}
+
 void EffectsLibrary::AddSuperEffect(Effect *effect)
 {
     std::string name = effect->GetPath();
@@ -176,8 +347,8 @@ void EffectsLibrary::AddSuperEffect(Effect *effect)
     {
         delete old->second;
         // no need to erase, we are assigning new one immediately
-    } else
-        // add new name
+    } else if (_index.find(name) == _index.end())
+        // add new name, the indexed ones are listed already
         _effects_names.push_back(name);
 
     _effects[name] = e;
@@ -228,6 +399,13 @@ void EffectsLibrary::ClearAll()
     for (auto it = _shapeList.begin(); it != _shapeList.end(); ++it)
         delete *it;
     _shapeList.clear();
+
+    // nothing uses their tables anymore
+    for (auto it = _loaders.begin(); it != _loaders.end(); ++it)
+        delete *it;
+    _loaders.clear();
+    _index.clear();
+    _unloadedShapes.clear();
 }
 
 Effect* EffectsLibrary::GetEffect( const char *name ) const
@@ -246,6 +424,22 @@ Emitter* EffectsLibrary::GetEmitter( const char *name ) const
     return NULL;
 }
 
+Effect* EffectsLibrary::GetEffect( const char *name )
+{
+    Effect *effect = static_cast<const EffectsLibrary*>(this)->GetEffect(name);
+    if (!effect && !_index.empty() && LoadIndexedEffect(name))
+        effect = static_cast<const EffectsLibrary*>(this)->GetEffect(name);
+    return effect;
+}
+
+Emitter* EffectsLibrary::GetEmitter( const char *name )
+{
+    Emitter *emitter = static_cast<const EffectsLibrary*>(this)->GetEmitter(name);
+    if (!emitter && !_index.empty() && LoadIndexedEffect(name))
+        emitter = static_cast<const EffectsLibrary*>(this)->GetEmitter(name);
+    return emitter;
+}
+
 void EffectsLibrary::SetUpdateFrequency( float freq )
 {
     _updateFrequency = freq;
@@ -288,7 +482,7 @@ float EffectsLibrary::GetLookupFrequencyOverTime()
     return _lookupFrequencyOverTime;
 }
 
-bool EffectsLibrary::AddSprite( AnimImage *sprite )
+bool EffectsLibrary::AddSprite( AnimImage *sprite, bool load /*= true*/ )
 {
     const char *filename = sprite->GetFilename();
 
@@ -302,7 +496,9 @@ bool EffectsLibrary::AddSprite( AnimImage *sprite )
         sprite->SetName(name);
     }
 
-    if (!sprite->Load())
+    if (!load)
+        _unloadedShapes.insert(sprite);     // loaded with the first effect using it
+    else if (!sprite->Load())
         return false;
 
     _shapeList.push_back(sprite);
@@ -23,6 +23,7 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <set>
 #include <string>
 
 //#define MARMALADE_DEBUG_TRACE 
@@ -137,7 +138,28 @@ namespace TLFX
         EffectsLibrary();
         virtual ~EffectsLibrary();
 
-        bool Load(const char *filename, bool compile = true);
+        /**
+         * Load the shapes and effects of a file
+         * <p>With lazy set, only the paths of the effects are read: #AllEffects lists them, without their sub effects, but each effect with
+         * its sub effects, emitters and the images they use is only loaded and compiled the first time it's asked for with #GetEffect or
+         * #GetEmitter. The file is kept open for that until #ClearAll. Use it for large libraries where only a few effects are used at a time.</p>
+         */
+        bool Load(const char *filename, bool compile = true, bool lazy = false);
+
+        /**
+         * Load a library saved with #SaveCompiled
+         * <p>The file is mapped in memory and the effects use the lookup tables compiled in it as they are, so this is much faster than
+         * #Load and the tables are shared by all the processes using the file. The file stays mapped until #ClearAll. See CompiledLibrary.</p>
+         * <p>lazy works as with #Load.</p>
+         */
+        bool LoadCompiled(const char *filename, bool lazy = false);
+
+        /**
+         * Save the shapes and effects of the library, with their compiled lookup tables, for #LoadCompiled
+         * The effects should have been compiled (see #Load) or they will be compiled when they are loaded. The effects of a lazy library
+         * that weren't loaded yet are loaded first.
+         */
+        bool SaveCompiled(const char *filename);
 
         /**
          * Set the current Update Frequency.
@@ -198,7 +220,8 @@ namespace TLFX
          * <p>Note that you should always use forward slashes.</p>
          * @return Effect*
          */
-        Effect* GetEffect(const char *name) const;
+        Effect* GetEffect(const char *name);
+        Effect* GetEffect(const char *name) const;                  // NULL for the effects that weren't loaded yet
 
         /**
          * Retrieve an emitter from the library
@@ -209,12 +232,25 @@ namespace TLFX
          * <p>Note that you should always use forward slashes.</p>
          * @return Emitter*
          */
-        Emitter* GetEmitter(const char *name) const;
+        Emitter* GetEmitter(const char *name);
+        Emitter* GetEmitter(const char *name) const;                // NULL for the emitters that weren't loaded yet
+
+        /**
+         * Unload an effect loaded lazily, see #Load
+         * The effect, its emitters and sub effects are deleted and will be loaded again by the next #GetEffect. No instance of it may be alive:
+         * they share its attributes.
+         * @return false if the effect isn't a top level effect loaded lazily
+         */
+        bool UnloadEffect(const char *name);
 
         const std::vector<std::string>& AllEffects() const { return _effects_names; }
         const std::vector<std::string>& AllEmitters() const { return _emitters_names; }
 
-        bool AddSprite(AnimImage* image);
+        /**
+         * Add a shape to the library
+         * @param load Load the image now, otherwise the first time an effect using it is loaded
+         */
+        bool AddSprite(AnimImage* image, bool load = true);
 
         virtual XMLLoader* CreateLoader() const = 0;
         virtual AnimImage* CreateImage() const = 0;
@@ -224,12 +260,29 @@ namespace TLFX
 #endif
 
     protected:
+        bool Load(XMLLoader *loader, const char *filename, bool compile, bool lazy, bool& indexed);
+        bool LoadIndexedEffect(const char *name);
+        void LoadShapes(Effect *effect);
+        void ReleaseEffect(Effect *effect, bool inLibrary);
+
         std::map<std::string, Effect*>  _effects;
         std::vector<std::string>        _effects_names;
         std::map<std::string, Emitter*> _emitters;
         std::vector<std::string>        _emitters_names;
         std::string                     _name;
         std::list<AnimImage*>           _shapeList;
+        std::set<AnimImage*>            _unloadedShapes;        // added but not loaded yet
+
+        // lazy loading
+        struct IndexedEffect
+        {
+            XMLLoader                   *loader;
+            bool                        super;
+            bool                        compile;
+            bool                        loaded;
+        };
+        std::map<std::string, IndexedEffect> _index;            // top level effects of the lazily loaded files
+        std::vector<XMLLoader*>         _loaders;               // loaders the effects still need: lazy ones, and the CompiledLibraries whose tables the effects use
 
         static float                    _updateFrequency; //  times per second
         static float                    _updateTime;
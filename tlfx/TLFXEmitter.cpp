@@ -4,6 +4,7 @@
 #include "TLFXAnimImage.h"
 #include "TLFXParticleManager.h"
 #include "TLFXParticle.h"
+#include "TLFXTaskPool.h"
 
 #include <algorithm>
 #include <cmath>
@@ -46,7 +47,11 @@ namespace TLFX
         , _tweenSpawns(false)
         , _once(false)
         , _dying(false)
+        , _controlParticles(NULL)
+        , _lockedDirections(false)
+        , _fastForwardConstant(true)
         , _groupParticles(false)
+        , _pooled(false)
 
         , _bypassWeight(false)
         , _bypassSpeed(false)
@@ -62,6 +67,7 @@ namespace TLFX
         , _bypassFramerate(false)
         , _bypassStretch(false)
         , _bypassSplatter(false)
+        , _controlKernel(&Emitter::ApplyControlChunk<0>)
 
         , _AABB_ParticleMaxWidth(0)
         , _AABB_ParticleMaxHeight(0)
@@ -88,6 +94,8 @@ namespace TLFX
     {
         _childrenOwner = false;         // the Particles are managing by pool
 
+        _table = new EmitterTable();
+
         _cAmount = new EmitterArray(EffectsLibrary::amountMin, EffectsLibrary::amountMax);
         _cLife = new EmitterArray(EffectsLibrary::lifeMin, EffectsLibrary::lifeMax);
         _cSizeX = new EmitterArray(EffectsLibrary::dimensionsMin, EffectsLibrary::dimensionsMax);
@@ -124,117 +132,13 @@ namespace TLFX
 
     Emitter::Emitter( const Emitter& o, ParticleManager *pm )
         : Entity(o)
-
-        , _currentLife(o._currentLife)
-        , _uniform(o._uniform)
-        , _parentEffect(NULL)
-        , _image(o._image)
-        , _handleCenter(o._handleCenter)
-        , _angleOffset(o._angleOffset)
-        , _lockedAngle(o._lockedAngle)
-        , _gx(o._gx)
-        , _gy(o._gy)
-        , _counter(o._counter)
-        , _oldCounter(o._oldCounter)
-        , _angleType(o._angleType)
-        , _angleRelative(o._angleRelative)
-        , _useEffectEmission(o._useEffectEmission)
-        , _deleted(o._deleted)
-        , _visible(o._visible)
-        , _singleParticle(o._singleParticle)
-        , _startedSpawning(o._startedSpawning)
-        , _spawned(o._spawned)
-        , _randomColor(o._randomColor)
-        , _zLayer(o._zLayer)
-        , _animate(o._animate)
-        , _randomStartFrame(o._randomStartFrame)
-        , _animationDirection(o._animationDirection)
-        , _colorRepeat(o._colorRepeat)
-        , _alphaRepeat(o._alphaRepeat)
-        , _dirAlternater(o._dirAlternater)
-        , _oneShot(o._oneShot)
-        , _particlesRelative(o._particlesRelative)
-        , _tweenSpawns(o._tweenSpawns)
-        , _once(o._once)
-        , _dying(o._dying)
-        , _groupParticles(o._groupParticles)
-
-        , _bypassWeight(o._bypassWeight)
-        , _bypassSpeed(o._bypassSpeed)
-        , _bypassSpin(o._bypassSpin)
-        , _bypassDirectionvariation(o._bypassDirectionvariation)
-        , _bypassColor(o._bypassColor)
-        , _bRed(o._bRed)
-        , _bGreen(o._bGreen)
-        , _bBlue(o._bBlue)
-        , _bypassScaleX(o._bypassScaleX)
-        , _bypassScaleY(o._bypassScaleY)
-        , _bypassLifeVariation(o._bypassLifeVariation)
-        , _bypassFramerate(o._bypassFramerate)
-        , _bypassStretch(o._bypassStretch)
-        , _bypassSplatter(o._bypassSplatter)
-
-        , _AABB_ParticleMaxWidth(o._AABB_ParticleMaxWidth)
-        , _AABB_ParticleMaxHeight(o._AABB_ParticleMaxHeight)
-        , _AABB_ParticleMinWidth(o._AABB_ParticleMinWidth)
-        , _AABB_ParticleMinHeight(o._AABB_ParticleMinHeight)
-
-        , _currentLifeVariation(o._currentLifeVariation)
-        , _currentWeight(o._currentWeight)
-        , _currentWeightVariation(o._currentWeightVariation)
-        , _currentSpeed(o._currentSpeed)
-        , _currentSpeedVariation(o._currentSpeedVariation)
-        , _currentSpin(o._currentSpin)
-        , _currentSpinVariation(o._currentSpinVariation)
-        , _currentDirectionVariation(o._currentDirectionVariation)
-        , _currentEmissionAngle(o._currentEmissionAngle)
-        , _currentEmissionRange(o._currentEmissionRange)
-        , _currentSizeX(o._currentSizeX)
-        , _currentSizeY(o._currentSizeY)
-        , _currentSizeXVariation(o._currentSizeXVariation)
-        , _currentSizeYVariation(o._currentSizeYVariation)
-        , _currentFramerate(o._currentFramerate)
-
         , _path(o._path)
-
-        , _arrayOwner(false)                // this copy (instance) is not owner
-        , _cR(o._cR)                        // copy the links to the templates
-        , _cG(o._cG)
-        , _cB(o._cB)
-        , _cBaseSpin(o._cBaseSpin)
-        , _cSpin(o._cSpin)
-        , _cSpinVariation(o._cSpinVariation)
-        , _cVelocity(o._cVelocity)
-        , _cBaseWeight(o._cBaseWeight)
-        , _cWeight(o._cWeight)
-        , _cWeightVariation(o._cWeightVariation)
-        , _cBaseSpeed(o._cBaseSpeed)
-        , _cVelVariation(o._cVelVariation)
-        //, _cAs(o._cAs)
-        , _cAlpha(o._cAlpha)
-        , _cSizeX(o._cSizeX)
-        , _cSizeY(o._cSizeY)
-        , _cScaleX(o._cScaleX)
-        , _cScaleY(o._cScaleY)
-        , _cSizeXVariation(o._cSizeXVariation)
-        , _cSizeYVariation(o._cSizeYVariation)
-        , _cLifeVariation(o._cLifeVariation)
-        , _cLife(o._cLife)
-        , _cAmount(o._cAmount)
-        , _cAmountVariation(o._cAmountVariation)
-        , _cEmissionAngle(o._cEmissionAngle)
-        , _cEmissionRange(o._cEmissionRange)
-        , _cGlobalVelocity(o._cGlobalVelocity)
-        , _cDirection(o._cDirection)
-        , _cDirectionVariation(o._cDirectionVariation)
-        , _cDirectionVariationOT(o._cDirectionVariationOT)
-        , _cFramerate(o._cFramerate)
-        , _cStretch(o._cStretch)
-        , _cSplatter(o._cSplatter)
+        , _pooled(false)
 
         // copy automatically: base/entity
         // not copy: 
     {
+        Assign(o);
         _dob = pm->GetCurrentTime();
         SetOKtoRender(false);
 
@@ -245,9 +149,141 @@ namespace TLFX
         }
     }
 
+    void Emitter::Assign( const Emitter& o )
+    {
+        _currentLife = o._currentLife;
+        _uniform = o._uniform;
+        _parentEffect = NULL;
+        _image = o._image;
+        _handleCenter = o._handleCenter;
+        _angleOffset = o._angleOffset;
+        _lockedAngle = o._lockedAngle;
+        _gx = o._gx;
+        _gy = o._gy;
+        _counter = o._counter;
+        _oldCounter = o._oldCounter;
+        _angleType = o._angleType;
+        _angleRelative = o._angleRelative;
+        _useEffectEmission = o._useEffectEmission;
+        _deleted = o._deleted;
+        _visible = o._visible;
+        _singleParticle = o._singleParticle;
+        _startedSpawning = o._startedSpawning;
+        _spawned = o._spawned;
+        _randomColor = o._randomColor;
+        _zLayer = o._zLayer;
+        _animate = o._animate;
+        _randomStartFrame = o._randomStartFrame;
+        _animationDirection = o._animationDirection;
+        _colorRepeat = o._colorRepeat;
+        _alphaRepeat = o._alphaRepeat;
+        _dirAlternater = o._dirAlternater;
+        _oneShot = o._oneShot;
+        _particlesRelative = o._particlesRelative;
+        _tweenSpawns = o._tweenSpawns;
+        _once = o._once;
+        _dying = o._dying;
+        _controlParticles = NULL;
+        _lockedDirections = false;
+        _fastForwardConstant = true;
+        _groupParticles = o._groupParticles;
+
+        _bypassWeight = o._bypassWeight;
+        _bypassSpeed = o._bypassSpeed;
+        _bypassSpin = o._bypassSpin;
+        _bypassDirectionvariation = o._bypassDirectionvariation;
+        _bypassColor = o._bypassColor;
+        _bRed = o._bRed;
+        _bGreen = o._bGreen;
+        _bBlue = o._bBlue;
+        _bypassScaleX = o._bypassScaleX;
+        _bypassScaleY = o._bypassScaleY;
+        _bypassLifeVariation = o._bypassLifeVariation;
+        _bypassFramerate = o._bypassFramerate;
+        _bypassStretch = o._bypassStretch;
+        _bypassSplatter = o._bypassSplatter;
+        _controlKernel = o._controlKernel;
+
+        _AABB_ParticleMaxWidth = o._AABB_ParticleMaxWidth;
+        _AABB_ParticleMaxHeight = o._AABB_ParticleMaxHeight;
+        _AABB_ParticleMinWidth = o._AABB_ParticleMinWidth;
+        _AABB_ParticleMinHeight = o._AABB_ParticleMinHeight;
+
+        _currentLifeVariation = o._currentLifeVariation;
+        _currentWeight = o._currentWeight;
+        _currentWeightVariation = o._currentWeightVariation;
+        _currentSpeed = o._currentSpeed;
+        _currentSpeedVariation = o._currentSpeedVariation;
+        _currentSpin = o._currentSpin;
+        _currentSpinVariation = o._currentSpinVariation;
+        _currentDirectionVariation = o._currentDirectionVariation;
+        _currentEmissionAngle = o._currentEmissionAngle;
+        _currentEmissionRange = o._currentEmissionRange;
+        _currentSizeX = o._currentSizeX;
+        _currentSizeY = o._currentSizeY;
+        _currentSizeXVariation = o._currentSizeXVariation;
+        _currentSizeYVariation = o._currentSizeYVariation;
+        _currentFramerate = o._currentFramerate;
+
+        _arrayOwner = false;                // this copy (instance) is not owner
+        _cR = o._cR;                        // copy the links to the templates
+        _cG = o._cG;
+        _cB = o._cB;
+        _cBaseSpin = o._cBaseSpin;
+        _cSpin = o._cSpin;
+        _cSpinVariation = o._cSpinVariation;
+        _cVelocity = o._cVelocity;
+        _cBaseWeight = o._cBaseWeight;
+        _cWeight = o._cWeight;
+        _cWeightVariation = o._cWeightVariation;
+        _cBaseSpeed = o._cBaseSpeed;
+        _cVelVariation = o._cVelVariation;
+        //_cAs = o._cAs;
+        _cAlpha = o._cAlpha;
+        _cSizeX = o._cSizeX;
+        _cSizeY = o._cSizeY;
+        _cScaleX = o._cScaleX;
+        _cScaleY = o._cScaleY;
+        _cSizeXVariation = o._cSizeXVariation;
+        _cSizeYVariation = o._cSizeYVariation;
+        _cLifeVariation = o._cLifeVariation;
+        _cLife = o._cLife;
+        _cAmount = o._cAmount;
+        _cAmountVariation = o._cAmountVariation;
+        _cEmissionAngle = o._cEmissionAngle;
+        _cEmissionRange = o._cEmissionRange;
+        _cGlobalVelocity = o._cGlobalVelocity;
+        _cDirection = o._cDirection;
+        _cDirectionVariation = o._cDirectionVariation;
+        _cDirectionVariationOT = o._cDirectionVariationOT;
+        _cFramerate = o._cFramerate;
+        _cStretch = o._cStretch;
+        _cSplatter = o._cSplatter;
+        _table = o._table;
+    }
+
+    void Emitter::Reuse( const Emitter& o, ParticleManager *pm )
+    {
+        assert(_children.empty());
+
+        base::Assign(o);
+        Assign(o);
+        _dob = pm->GetCurrentTime();
+        SetOKtoRender(false);
+        _fastForwardTicks.clear();
+    }
 
     Emitter::~Emitter()
     {
+        if (_pooled)
+        {
+            for (auto it = _effects.begin(); it != _effects.end(); ++it)
+            {
+                (*it)->Destroy();
+                delete *it;
+            }
+        }
+
         if (_arrayOwner)
         {
             delete _cR;
@@ -283,6 +319,7 @@ namespace TLFX
             delete _cFramerate;
             delete _cStretch;
             delete _cSplatter;
+            delete _table;
         }
     }
 
@@ -553,6 +590,11 @@ namespace TLFX
         _useEffectEmission = value;
     }
 
+    bool Emitter::IsUseEffectEmission() const
+    {
+        return _useEffectEmission;
+    }
+
     void Emitter::SetVisible( bool value )
     {
         _visible = value;
@@ -777,13 +819,16 @@ namespace TLFX
     {
         _parentEffect = NULL;
         _image = NULL;
-        // Effect
-        for (auto it = _effects.begin(); it != _effects.end(); ++it)
+        // Effect, a pooled emitter keeps them for its next life
+        if (!_pooled)
         {
-            (*it)->Destroy();
-            delete *it;
+            for (auto it = _effects.begin(); it != _effects.end(); ++it)
+            {
+                (*it)->Destroy();
+                delete *it;
+            }
+            _effects.clear();
         }
-        _effects.clear();
 
         base::Destroy(false);
     }
@@ -802,7 +847,7 @@ namespace TLFX
     {
         Capture();
 
-        _matrix.Set(cosf(_angle / 180.0f * (float)M_PI), sinf(_angle / 180.0f * (float)M_PI), -sinf(_angle / 180.0f * (float)M_PI), cosf(_angle / 180.0f * (float)M_PI));
+        UpdateRotationMatrix();
 
         if (_parent && _relative)
         {
@@ -834,7 +879,7 @@ namespace TLFX
         if (_radiusCalculate)
             base::UpdateEntityRadius();
 
-        UpdateChildren();
+        UpdateParticles();
 
         if (!_dead && !_dying)
         {
@@ -856,6 +901,345 @@ namespace TLFX
         return true;
     }
 
+    void Emitter::UpdateParticles()
+    {
+        if (_parentEffect->GetParticleManager()->IsFastForwarding() && CanFastForward())
+        {
+            // only the ages matter until FastForwardParticles, which needs the global attributes of every tick
+            FastForwardTick tick;
+            tick.globalVelocity = GetEmitterGlobalVelocity(_parentEffect->GetCurrentEffectFrame());
+            tick.spin = _parentEffect->GetCurrentSpin();
+            if (!_fastForwardTicks.empty())
+            {
+                const FastForwardTick& last = _fastForwardTicks.back();
+                _fastForwardConstant = _fastForwardConstant && last.globalVelocity == tick.globalVelocity && last.spin == tick.spin;
+            }
+            _fastForwardTicks.push_back(tick);
+            AgeParticles();
+            return;
+        }
+
+        int count = (int)_children.size();
+        if (count == 0)
+            return;
+
+        _updateQueue.resize(count);
+        int i = 0;
+        for (auto it = _children.begin(); it != _children.end(); ++it, ++i)
+        {
+            Particle *e = static_cast<Particle*>(*it);
+            assert(e->_parent == this);
+            _updateQueue[i] = e;
+        }
+
+        // age, integrate and transform the particles, a chunk at a time
+        _integrateBatch.Resize(count);
+        ForEachChunk(count, &Emitter::IntegrateChunk);
+
+        // and finish the update of each particle, in the same order as Entity::Update. Bounds are accumulated into the parents and dead
+        // particles go back to the manager, so this part is serial. Without sub effects nothing else happens between the particles, so the
+        // particles still alive can all be controlled at once afterwards
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+        bool batchControl = _effects.empty();
+        _controlQueue.clear();
+        for (auto it = _children.begin(); it != _children.end(); )
+        {
+            Particle *e = static_cast<Particle*>(*it);
+            if (!batchControl)
+                e->UpdateWorldMatrix();
+            e->UpdateFrameAndBounds(currentUpdateTime);
+            e->UpdateChildren();
+            bool control = !batchControl || !e->_children.empty();
+            if (!e->EndUpdate(control))
+            {
+                if (_childrenOwner) delete *it;
+                it = _children.erase(it);
+            }
+            else
+            {
+                if (!control)
+                    _controlQueue.push_back(e);
+                ++it;
+            }
+        }
+
+        if (!_controlQueue.empty())
+        {
+            ControlParticles(&_controlQueue[0], (int)_controlQueue.size());
+        }
+    }
+
+    void Emitter::IntegrateChunk( int begin, int end )
+    {
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+
+        // gather the motion state
+        IntegrateBatch& b = _integrateBatch;
+        int trigCount = 0;
+        unsigned int trigGeneration = Math::GetTrigGeneration();
+        for (int i = begin; i < end; ++i)
+        {
+            Particle *e = _updateQueue[i];
+            e->BeginUpdate();
+
+            b.x[i] = e->_x;
+            b.y[i] = e->_y;
+            b.z[i] = e->_z;
+            b.gravity[i] = e->_gravity;
+            b.speedVecX[i] = e->_speedVec.x;
+            b.speedVecY[i] = e->_speedVec.y;
+            b.pixelsPerSecond[i] = e->_pixelsPerSecond;
+            b.speed[i] = e->_updateSpeed ? e->_speed : 0;
+            if (b.speed[i] != 0 && (e->_direction != e->_trigDirection || e->_trigDirectionGeneration != trigGeneration))
+            {
+                b.trigDirection[begin + trigCount] = e->_direction;
+                b.trigIndex[begin + trigCount] = i;
+                ++trigCount;
+            }
+            b.directionSin[i] = e->_directionSin;
+            b.directionCos[i] = e->_directionCos;
+            b.weight[i] = e->_weight;
+            b.relative[i] = e->_relative ? 1.0f : 0;
+        }
+
+        // the sines and cosines of the directions that changed, in one call (the same values UpdateDirectionTrig computes)
+        if (trigCount > 0)
+        {
+            Math::SinCosArray(&b.trigDirection[begin], &b.trigSin[begin], &b.trigCos[begin], trigCount);
+            for (int k = begin; k < begin + trigCount; ++k)
+            {
+                int i = b.trigIndex[k];
+                Particle *e = _updateQueue[i];
+                e->_directionSin = b.directionSin[i] = b.trigSin[k];
+                e->_directionCos = b.directionCos[i] = b.trigCos[k];
+                e->_trigDirection = b.trigDirection[k];
+                e->_trigDirectionGeneration = trigGeneration;
+            }
+        }
+
+        Kernels::Integrate(b, begin, end, currentUpdateTime, _matrix, _wx, _wy, _z);
+
+        // scatter it back. With sub effects the matrix is updated by UpdateParticles, just before the sub effects of the particle
+        bool updateMatrix = _effects.empty();
+        for (int i = begin; i < end; ++i)
+        {
+            Particle *e = _updateQueue[i];
+            e->_x = b.x[i];
+            e->_y = b.y[i];
+            e->_z = b.z[i];
+            e->_gravity = b.gravity[i];
+            e->_speedVec.x = b.speedVecX[i];
+            e->_speedVec.y = b.speedVecY[i];
+            e->_pixelsPerSecond = b.pixelsPerSecond[i];
+            e->_wx = b.wx[i];
+            e->_wy = b.wy[i];
+            if (updateMatrix)
+                e->UpdateWorldMatrix();
+        }
+    }
+
+    void Emitter::ForEachChunk( int count, ChunkMethod method )
+    {
+        TaskPool *pool = _parentEffect->GetParticleManager()->GetTaskPool();
+        int chunks = (count + particleChunk - 1) / particleChunk;
+        if (!pool || chunks < 2 || TaskPool::IsInTask())
+        {
+            (this->*method)(0, count);
+            return;
+        }
+
+        Chunks job;
+        job.emitter = this;
+        job.method = method;
+        job.count = count;
+        pool->Run(chunks, RunChunk, &job);
+    }
+
+    void Emitter::RunChunk( void *arg, int index )
+    {
+        Chunks *job = static_cast<Chunks*>(arg);
+        int begin = index * particleChunk;
+        int end = std::min(begin + particleChunk, job->count);
+        (job->emitter->*job->method)(begin, end);
+    }
+
+    bool Emitter::CanFastForward() const
+    {
+        return _effects.empty() && _bypassDirectionvariation && !_singleParticle && _table->IsCurrent()
+            && !(_parentEffect->GetTraverseEdge() && _parentEffect->GetClass() == Effect::TypeLine);
+    }
+
+    void Emitter::AgeParticles()
+    {
+        float currentTime = _parentEffect->GetParticleManager()->GetCurrentTime();
+        for (auto it = _children.begin(); it != _children.end(); )
+        {
+            Particle *e = static_cast<Particle*>(*it);
+            e->_age = currentTime - e->_dob;
+            if (!e->EndUpdate(false))
+            {
+                if (_childrenOwner) delete *it;
+                it = _children.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    void Emitter::FastForwardParticles()
+    {
+        if (!CanFastForward())
+        {
+            for (auto it = _children.begin(); it != _children.end(); ++it)
+            {
+                Particle *e = static_cast<Particle*>(*it);
+                for (auto fx = e->_children.begin(); fx != e->_children.end(); ++fx)
+                    static_cast<Effect*>(*fx)->FastForwardParticles();
+            }
+            return;
+        }
+
+        _controlQueue.clear();
+        for (auto it = _children.begin(); it != _children.end(); ++it)
+        {
+            Particle *e = static_cast<Particle*>(*it);
+            if (ReplayParticle(e))
+                _controlQueue.push_back(e);
+        }
+        _fastForwardTicks.clear();
+        _fastForwardConstant = true;
+
+        if (!_controlQueue.empty())
+        {
+            ControlParticles(&_controlQueue[0], (int)_controlQueue.size());
+        }
+    }
+
+    bool Emitter::ReplayParticle( Particle *e )
+    {
+        float updateTime = EffectsLibrary::GetUpdateTime();
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+        int ticks = (int)(e->_age / updateTime + 0.5f);
+        if (ticks < 1 || ticks > (int)_fastForwardTicks.size())
+            return false;       // spawned by the last tick, not updated yet
+
+        // the tick the particle was controlled for the k-th time
+        const FastForwardTick *history = &_fastForwardTicks[_fastForwardTicks.size() - ticks];
+
+        const EmitterTable& t = *_table;
+        float life = (float)t.GetLife(), frequency = EffectsLibrary::GetLookupFrequencyOverTime(), lifetime = (float)e->_lifeTime;
+        bool constantCurves = _fastForwardConstant && _alphaRepeat <= 1 && _colorRepeat <= 1
+            && t.IsConstant(EmitterTable::Velocity) && t.IsConstant(EmitterTable::Direction) && t.IsConstant(EmitterTable::Weight)
+            && t.IsConstant(EmitterTable::Spin) && t.IsConstant(EmitterTable::Framerate);
+
+        // every tick but the last: integrate with the values of the previous tick, then set the values the control would set
+        for (int tick = 1; tick < ticks; ++tick)
+        {
+            e->UpdateMotion(currentUpdateTime);
+            AdvanceFrame(e, e->_framerate / currentUpdateTime);
+
+            float age = e->_age - (ticks - tick) * updateTime;
+            int row;
+            Kernels::OverTimeIndex(t.GetLastRow(), life, frequency, &age, &lifetime, &row, 1);
+            ControlFastForward(e, t.GetRow(row), history[tick - 1]);
+
+            if (constantCurves && tick < ticks - 1)
+            {
+                SkipConstantTicks(e, ticks - 1 - tick, history[0]);
+                break;
+            }
+        }
+
+        // the last tick is a regular one, the caller controls the particle afterwards
+        e->Capture();
+        e->UpdateMotion(currentUpdateTime);
+        e->UpdateWorldPosition();
+        e->UpdateWorldMatrix();
+        e->UpdateFrameAndBounds(currentUpdateTime);
+        return true;
+    }
+
+    void Emitter::SkipConstantTicks( Particle *e, int ticks, const FastForwardTick& tick )
+    {
+        // the values don't change anymore, the ticks left before the last one add up
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+        float m = (float)ticks;
+        if (e->_updateSpeed && e->_speed != 0)
+        {
+            e->UpdateDirectionTrig();
+            float pps = e->_speed / currentUpdateTime;
+            e->_x += m * e->_directionSin * pps * e->_z;
+            e->_y -= m * e->_directionCos * pps * e->_z;
+        }
+        if (e->_weight != 0)
+        {
+            float g = e->_weight / currentUpdateTime;
+            e->_y += ((m * e->_gravity + g * m * (m + 1) * 0.5f) / currentUpdateTime) * e->_z;
+            e->_gravity += m * g;
+        }
+        AdvanceFrame(e, m * e->_framerate / currentUpdateTime);
+        if (!(_lockedAngle && _angleType == AngAlign) && !_bypassSpin)
+        {
+            float spinStep = (_table->GetRow(0)[EmitterTable::Spin] * e->_spinVariation * tick.spin) / currentUpdateTime;
+            e->_angle += m * spinStep;
+        }
+    }
+
+    void Emitter::ControlFastForward( Particle *e, const float *row, const FastForwardTick& tick )
+    {
+        // the part of ApplyControlChunk that carries over to the next tick
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+        if (!(_lockedAngle && _angleType == AngAlign) && !_bypassSpin)
+            e->_angle += (row[EmitterTable::Spin] * e->_spinVariation * tick.spin) / currentUpdateTime;
+
+        e->_direction = e->_emissionAngle + row[EmitterTable::Direction] + e->_randomDirection;
+
+        if (!_bypassFramerate)
+            e->_framerate = row[EmitterTable::Framerate] * _animationDirection;
+
+        e->_speed = e->_randomSpeed;
+        if (!_bypassSpeed)
+            e->_speed += row[EmitterTable::Velocity] * e->_baseSpeed * tick.globalVelocity;
+
+        if (!_bypassWeight)
+            e->_weight = row[EmitterTable::Weight] * e->_baseWeight;
+
+        if (_alphaRepeat > 1)
+        {
+            e->_rptAgeA += currentUpdateTime * _alphaRepeat;
+            if (e->_rptAgeA > e->_lifeTime && e->_aCycles < _alphaRepeat)
+            {
+                e->_rptAgeA -= e->_lifeTime;
+                ++e->_aCycles;
+            }
+        }
+        if (!_bypassColor && !_randomColor && _colorRepeat > 1)
+        {
+            e->_rptAgeC += currentUpdateTime * _colorRepeat;
+            if (e->_rptAgeC > e->_lifeTime && e->_cCycles < _colorRepeat)
+            {
+                e->_rptAgeC -= e->_lifeTime;
+                ++e->_cCycles;
+            }
+        }
+    }
+
+    void Emitter::AdvanceFrame( Particle *e, float frames )
+    {
+        // as Entity::UpdateFrameAndBounds
+        if (e->_avatar && e->_animating)
+        {
+            e->_currentFrame += frames;
+            if (e->_animateOnce)
+            {
+                if (e->_currentFrame > e->_avatar->GetFramesCount() - 1)
+                    e->_currentFrame = (float)(e->_avatar->GetFramesCount() - 1);
+                else if (e->_currentFrame <= 0)
+                    e->_currentFrame = 0;
+            }
+        }
+    }
+
     void Emitter::UpdateSpawns( Particle *eSingle /*= NULL*/ )
     {
         int intCounter;
@@ -946,9 +1330,6 @@ namespace TLFX
                     ++EffectsLibrary::particlesCreated;
 #endif
                     // -----Link to its emitter and assign the control source (which is this emitter)----
-					std::string particleName = "(particle)";
-					particleName.append(GetName());
-					e->SetName(particleName.c_str());
                     e->SetEmitter(this);
                     e->SetParent(this);
                     e->SetParticleManager(pm);
@@ -1330,6 +1711,7 @@ namespace TLFX
                     {
                         e->SetDirectionLocked(true);
                         e->SetEntityDirection(90.0f);
+                        _lockedDirections = true;
                     }
                     else
                     {
@@ -1414,8 +1796,10 @@ namespace TLFX
                     {
                         if (!_bypassWeight && !_bypassSpeed && !_parentEffect->IsBypassWeight())
                         {
-                            e->SetSpeedVecX(sinf(e->GetEntityDirection() / 180.0f * (float)M_PI));
-                            e->SetSpeedVecY(cosf(e->GetEntityDirection() / 180.0f * (float)M_PI));
+                            float s, c;
+                            Math::SinCos(e->GetEntityDirection(), s, c);
+                            e->SetSpeedVecX(s);
+                            e->SetSpeedVecY(c);
                             e->SetAngle(Vector2::GetDirection(0, 0, e->GetSpeedVecX(), -e->GetSpeedVecY()));
                         }
                         else
@@ -1484,7 +1868,8 @@ namespace TLFX
                     // Effect
                     for (auto it = _effects.begin(); it != _effects.end(); ++it)
                     {
-                        Effect* newEffect = new Effect(*static_cast<Effect*>(*it), pm);
+                        Effect* newEffect = pm->GrabEffect(*static_cast<Effect*>(*it));
+                        newEffect->SetSeed((int)_parentEffect->GetRandom().Next());
                         newEffect->SetParent(e);
                         newEffect->SetParentEmitter(this);
                         newEffect->SetEffectLayer(e->_effectLayer);
@@ -1494,8 +1879,8 @@ namespace TLFX
                     // get the relative angle
                     if (!e->_relative)
                     {  // @todo dan Set(cosf(_angle  ??
-                        float angle = _angle / 180.0f * (float)M_PI;
-                        e->_matrix.Set(cosf(angle), sinf(angle), -sinf(angle), cosf(angle));
+                        UpdateAngleTrig();
+                        e->_matrix.Set(_angleCos, _angleSin, -_angleSin, _angleCos);
                         e->_matrix = e->_matrix.Transform(_parent->GetMatrix());
                     }
                     e->_relativeAngle = _parent->GetRelativeAngle() + e->_angle;
@@ -1513,221 +1898,474 @@ namespace TLFX
 
     void Emitter::ControlParticle( Particle *e )
     {
+        ControlParticles(&e, 1);
+    }
 
-        // alpha change
-        if (_alphaRepeat > 1)
+    void Emitter::ControlBatch::Resize( int count )
+    {
+        age.resize(count);
+        lifetime.resize(count);
+        alphaAge.resize(count);
+        colorAge.resize(count);
+        alpha.resize(count);
+        spin.resize(count);
+        directionVariation.resize(count);
+        direction.resize(count);
+        scaleX.resize(count);
+        scaleY.resize(count);
+        r.resize(count);
+        g.resize(count);
+        b.resize(count);
+        framerate.resize(count);
+        velocity.resize(count);
+        stretch.resize(count);
+        weight.resize(count);
+        row.resize(count);
+        alphaRow.resize(count);
+        colorRow.resize(count);
+    }
+
+    void Emitter::ControlParticles( Particle* const *particles, int count )
+    {
+        if (count <= 0)
+            return;
+
+        _controlBatch.Resize(count);
+        _controlParticles = particles;
+
+        // gather the ages and table rows, then sample and apply the attributes with the kernel of the emitter. Both only touch the
+        // particle itself so they run a chunk at a time; the motion randomness draws random numbers so it stays serial, in the order of
+        // the particles
+        ForEachChunk(count, &Emitter::GatherControlChunk);
+        RandomizeMotion(particles, count);
+        ForEachChunk(count, _controlKernel);
+
+        _controlParticles = NULL;
+    }
+
+    void Emitter::GatherControlChunk( int begin, int end )
+    {
+        ControlBatch& cb = _controlBatch;
+        Particle* const *particles = _controlParticles;
+        const EmitterTable *table = _table->IsCurrent() ? _table : NULL;
+
+        for (int i = begin; i < end; ++i)
         {
-            e->_rptAgeA += EffectsLibrary::GetCurrentUpdateTime() * _alphaRepeat;
-            e->_alpha = GetEmitterAlpha(e->_rptAgeA, (float)e->_lifeTime) * _parentEffect->GetCurrentAlpha();
-            if (e->_rptAgeA > e->_lifeTime && e->_aCycles < _alphaRepeat)
-            {
-                e->_rptAgeA -= e->_lifeTime;
-                ++e->_aCycles;
-            }
+            Particle *e = particles[i];
+            cb.age[i] = e->_age;
+            cb.lifetime[i] = (float)e->_lifeTime;
+        }
+        IndexRows(table, &cb.age[0], &cb.row[0], begin, end);
+
+        if (!_bypassDirectionvariation)
+            SampleColumn(table, EmitterTable::DirectionVariation, _cDirectionVariationOT, &cb.age[0], &cb.row[0], &cb.directionVariation[0], begin, end);
+    }
+
+    void Emitter::IndexRows( const EmitterTable *table, const float *ages, int *rows, int begin, int end ) const
+    {
+        if (table)
+        {
+            // all the attributes of a particle are in the same row of the table
+            Kernels::OverTimeIndex(table->GetLastRow(), (float)table->GetLife(), EffectsLibrary::GetLookupFrequencyOverTime(),
+                                   &ages[begin], &_controlBatch.lifetime[begin], &rows[begin], end - begin);
+        }
+    }
+
+    void Emitter::SampleColumn( const EmitterTable *table, int column, const EmitterArray *curve, const float *ages, const int *rows, float *out,
+                                int begin, int end ) const
+    {
+        if (table)
+        {
+            for (int i = begin; i < end; ++i)
+                out[i] = table->GetRow(rows[i])[column];
         }
         else
         {
-            e->_alpha = GetEmitterAlpha(e->_age, (float)e->_lifeTime) * _parentEffect->GetCurrentAlpha();
+            curve->GetOTBatch(&ages[begin], &_controlBatch.lifetime[begin], &out[begin], end - begin);
         }
+    }
 
-        // angle changes
-        if (_lockedAngle && _angleType == AngAlign)
+    float Emitter::Rnd( float range )
+    {
+        return _parentEffect->GetRandom().Rnd(range);
+    }
+
+    float Emitter::Rnd( float min, float max )
+    {
+        return _parentEffect->GetRandom().Rnd(min, max);
+    }
+
+    void Emitter::RandomizeMotion( Particle* const *particles, int count )
+    {
+        if (_bypassDirectionvariation)
+            return;
+
+        const ControlBatch& cb = _controlBatch;
+        for (int i = 0; i < count; ++i)
         {
+            Particle *e = particles[i];
             if (e->_directionLocked)
+                continue;
+
+            float dv = e->_directionVariation * cb.directionVariation[i];
+            e->_timeTracker += (int)EffectsLibrary::GetUpdateTime();
+            if (e->_timeTracker > EffectsLibrary::motionVariationInterval)
             {
-                e->_angle = _parentEffect->GetAngle() + _angle + _angleOffset;
+                e->_randomDirection += EffectsLibrary::maxDirectionVariation * Rnd(-dv, dv);
+                e->_randomSpeed += EffectsLibrary::maxVelocityVariation * Rnd(-dv, dv);
+                e->_timeTracker = 0;
             }
-            else
-            {
-                if (!_bypassWeight && (!_parentEffect->IsBypassWeight() || e->_direction))
-                {
-                    if (e->_oldWX != e->_wx && e->_oldWY != e->_wy)
-                    {
-                        if (e->_relative)
-                            e->_angle = Vector2::GetDirection(e->_oldX, e->_oldY, e->_x, e->_y);
-                        else
-                            e->_angle = Vector2::GetDirection(e->_oldWX, e->_oldWY, e->_wx, e->_wy);
+        }
+    }
 
-                        if (fabsf(e->_oldAngle - e->_angle) > 180)
-                        {
-                            if (e->_oldAngle > e->_angle)
-                                e->_oldAngle -= 360;
-                            else
-                                e->_oldAngle += 360;
-                        }
-                    }
-                }
-                else
+    template <unsigned int Flags>
+    void Emitter::ApplyControlChunk( int begin, int end )
+    {
+        ControlBatch& cb = _controlBatch;
+        Particle* const *particles = _controlParticles;
+        const EmitterTable *table = _table->IsCurrent() ? _table : NULL;
+        const float *ages = &cb.age[0];
+        const int *rows = &cb.row[0];
+        float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
+        float imageWidth = _image->GetWidth(), imageHeight = _image->GetHeight();
+
+        // each attribute is sampled for the chunk and then applied, one loop per attribute with the emitter's settings tested
+        // before the loop, so the kernel only reads the columns it uses
+
+        // alpha change, the repeat ages are advanced before sampling and wrapped after, just like the single particle path did
+        float effectAlpha = _parentEffect->GetCurrentAlpha();
+        if (_alphaRepeat > 1)
+        {
+            for (int i = begin; i < end; ++i)
+            {
+                Particle *e = particles[i];
+                e->_rptAgeA += currentUpdateTime * _alphaRepeat;
+                cb.alphaAge[i] = e->_rptAgeA;
+            }
+            IndexRows(table, &cb.alphaAge[0], &cb.alphaRow[0], begin, end);
+            SampleColumn(table, EmitterTable::Alpha, _cAlpha, &cb.alphaAge[0], &cb.alphaRow[0], &cb.alpha[0], begin, end);
+            for (int i = begin; i < end; ++i)
+            {
+                Particle *e = particles[i];
+                e->_alpha = cb.alpha[i] * effectAlpha;
+                if (e->_rptAgeA > e->_lifeTime && e->_aCycles < _alphaRepeat)
                 {
-                    e->_angle = e->_direction + _angle + _angleOffset;
+                    e->_rptAgeA -= e->_lifeTime;
+                    ++e->_aCycles;
                 }
             }
         }
         else
         {
-            if (!_bypassSpin)
-                e->_angle += (GetEmitterSpin(e->_age, (float)e->_lifeTime) * e->_spinVariation * _parentEffect->GetCurrentSpin()) / EffectsLibrary::GetCurrentUpdateTime();
+            SampleColumn(table, EmitterTable::Alpha, _cAlpha, ages, rows, &cb.alpha[0], begin, end);
+            for (int i = begin; i < end; ++i)
+                particles[i]->_alpha = cb.alpha[i] * effectAlpha;
         }
 
-        // direction changes and motion randomness
-        if (e->_directionLocked)
+        // angle changes
+        if (_lockedAngle && _angleType == AngAlign)
+        {
+            for (int i = begin; i < end; ++i)
+                ControlAlignedAngle(particles[i]);
+        }
+        else if (!(Flags & ControlNoSpin))
         {
-            e->_direction = 90;
-            switch (_parentEffect->GetClass())
+            SampleColumn(table, EmitterTable::Spin, _cSpin, ages, rows, &cb.spin[0], begin, end);
+            float effectSpin = _parentEffect->GetCurrentSpin();
+            for (int i = begin; i < end; ++i)
             {
-            case Effect::TypeLine:
-                if (_parentEffect->GetDistanceSetByLife())
-                {
-                    float life = e->_age / e->_lifeTime;
-                    e->_x = (life * _parentEffect->GetCurrentWidth()) - _parentEffect->GetHandleX();
-                }
-                else
-                {
-                    switch (_parentEffect->GetEndBehavior())
-                    {
-                    case Effect::EndKill:
-                        if (e->_x > _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX() || e->_x < 0 - _parentEffect->GetHandleX())
-                            e->_dead = 2;
-                        break;
+                Particle *e = particles[i];
+                e->_angle += (cb.spin[i] * e->_spinVariation * effectSpin) / currentUpdateTime;
+            }
+        }
 
-                    case Effect::EndLoopAround:
-                        if (e->_x > _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX())
-                        {
-                            e->_x = (float)(-_parentEffect->GetHandleX());
-                            e->MiniUpdate();
-                            e->_oldX = e->_x;
-                            e->_oldWX = e->_wx;
-                            e->_oldWY = e->_wy;
-                        }
-                        else if (e->_x < 0 - _parentEffect->GetHandleX())
-                        {
-                            e->_x = _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX();
-                            e->MiniUpdate();
-                            e->_oldX = e->_x;
-                            e->_oldWX = e->_wx;
-                            e->_oldWY = e->_wy;
-                        }
-                        break;
-					case Effect::EndLetFree:
-						break;
-                    }
-                }
-				break;
-			default:
-				break;
+        // direction changes and motion randomness (see RandomizeMotion)
+        SampleColumn(table, EmitterTable::Direction, _cDirection, ages, rows, &cb.direction[0], begin, end);
+        if (_lockedDirections)
+        {
+            for (int i = begin; i < end; ++i)
+            {
+                Particle *e = particles[i];
+                if (e->_directionLocked)
+                    ControlLockedDirection(e);
+                else
+                    e->_direction = e->_emissionAngle + cb.direction[i] + e->_randomDirection;
             }
         }
         else
         {
-            if (!_bypassDirectionvariation)
+            for (int i = begin; i < end; ++i)
             {
-                float dv = e->_directionVariation * GetEmitterDirectionVariationOT(e->_age, (float)e->_lifeTime);
-                e->_timeTracker += (int)EffectsLibrary::GetUpdateTime();
-                if (e->_timeTracker > EffectsLibrary::motionVariationInterval)
-                {
-                    e->_randomDirection += EffectsLibrary::maxDirectionVariation * Rnd(-dv, dv);
-                    e->_randomSpeed += EffectsLibrary::maxVelocityVariation * Rnd(-dv, dv);
-                    e->_timeTracker = 0;
-                }
+                Particle *e = particles[i];
+                e->_direction = e->_emissionAngle + cb.direction[i] + e->_randomDirection;
             }
-            e->_direction = e->_emissionAngle + GetEmitterDirection(e->_age, (float)e->_lifeTime) + e->_randomDirection;
         }
 
-        // size changes
-        if (!_bypassScaleX)
-        {
-            e->_scaleX = (GetEmitterScaleX(e->_age, (float)e->_lifeTime) * e->_gSizeX * e->_width) / _image->GetWidth();
-        }
-        if (_uniform)
+        // size changes, the stretch needs the scale of the axis it stretches even when the scale itself is bypassed
+        if (!(Flags & ControlNoScaleX) || (_uniform && !(Flags & ControlNoStretch)))
+            SampleColumn(table, EmitterTable::ScaleX, _cScaleX, ages, rows, &cb.scaleX[0], begin, end);
+        if (!_uniform && (!(Flags & ControlNoScaleY) || !(Flags & ControlNoStretch)))
+            SampleColumn(table, EmitterTable::ScaleY, _cScaleY, ages, rows, &cb.scaleY[0], begin, end);
+        if (!(Flags & ControlNoScaleX))
         {
-            if (!_bypassScaleX)
-                e->_scaleY = e->_scaleX;
+            if (_uniform)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    Particle *e = particles[i];
+                    e->_scaleX = (cb.scaleX[i] * e->_gSizeX * e->_width) / imageWidth;
+                    e->_scaleY = e->_scaleX;
+                }
+            }
+            else
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    Particle *e = particles[i];
+                    e->_scaleX = (cb.scaleX[i] * e->_gSizeX * e->_width) / imageWidth;
+                }
+            }
         }
-        else
+        if (!(Flags & ControlNoScaleY) && !_uniform)
         {
-            if (!_bypassScaleY)
+            for (int i = begin; i < end; ++i)
             {
-                e->_scaleY = (GetEmitterScaleY(e->_age, (float)e->_lifeTime) * e->_gSizeY * e->_height) / _image->GetHeight();
+                Particle *e = particles[i];
+                e->_scaleY = (cb.scaleY[i] * e->_gSizeY * e->_height) / imageHeight;
             }
         }
 
-        // color changes
-        if (!_bypassColor)
+        // color changes, repeating like the alpha
+        if (!(Flags & ControlNoColor) && !_randomColor)
         {
-            if (!_randomColor)
+            const float *colorAges = ages;
+            const int *colorRows = rows;
+            if (_colorRepeat > 1)
             {
-                if (_colorRepeat > 1)
+                for (int i = begin; i < end; ++i)
                 {
-                    e->_rptAgeC += EffectsLibrary::GetCurrentUpdateTime() * _colorRepeat;
-                    e->_red = (unsigned char)GetEmitterR(e->_rptAgeC, (float)e->_lifeTime);
-                    e->_green = (unsigned char)GetEmitterG(e->_rptAgeC, (float)e->_lifeTime);
-                    e->_blue = (unsigned char)GetEmitterB(e->_rptAgeC, (float)e->_lifeTime);
+                    Particle *e = particles[i];
+                    e->_rptAgeC += currentUpdateTime * _colorRepeat;
+                    cb.colorAge[i] = e->_rptAgeC;
+                }
+                IndexRows(table, &cb.colorAge[0], &cb.colorRow[0], begin, end);
+                colorAges = &cb.colorAge[0];
+                colorRows = &cb.colorRow[0];
+            }
+            SampleColumn(table, EmitterTable::R, _cR, colorAges, colorRows, &cb.r[0], begin, end);
+            SampleColumn(table, EmitterTable::G, _cG, colorAges, colorRows, &cb.g[0], begin, end);
+            SampleColumn(table, EmitterTable::B, _cB, colorAges, colorRows, &cb.b[0], begin, end);
+            for (int i = begin; i < end; ++i)
+            {
+                Particle *e = particles[i];
+                e->_red = (unsigned char)cb.r[i];
+                e->_green = (unsigned char)cb.g[i];
+                e->_blue = (unsigned char)cb.b[i];
+            }
+            if (_colorRepeat > 1)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    Particle *e = particles[i];
                     if (e->_rptAgeC > e->_lifeTime && e->_cCycles < _colorRepeat)
                     {
                         e->_rptAgeC -= e->_lifeTime;
                         ++e->_cCycles;
                     }
                 }
-                else
-                {
-                    e->_red = (unsigned char)GetEmitterR(e->_age, (float)e->_lifeTime);
-                    e->_green = (unsigned char)GetEmitterG(e->_age, (float)e->_lifeTime);
-                    e->_blue = (unsigned char)GetEmitterB(e->_age, (float)e->_lifeTime);
-                }
             }
         }
 
         // animation
-        if (!_bypassFramerate)
-            e->_framerate = GetEmitterFramerate(e->_age, (float)e->_lifeTime) * _animationDirection;
+        if (!(Flags & ControlNoFramerate))
+        {
+            SampleColumn(table, EmitterTable::Framerate, _cFramerate, ages, rows, &cb.framerate[0], begin, end);
+            for (int i = begin; i < end; ++i)
+                particles[i]->_framerate = cb.framerate[i] * _animationDirection;
+        }
 
         // speed changes
-        if (!_bypassSpeed)
+        if (!(Flags & ControlNoSpeed))
         {
-            e->_speed = GetEmitterVelocity(e->_age, (float)e->_lifeTime) * e->_baseSpeed * GetEmitterGlobalVelocity(_parentEffect->GetCurrentEffectFrame());
-            e->_speed += e->_randomSpeed;
+            SampleColumn(table, EmitterTable::Velocity, _cVelocity, ages, rows, &cb.velocity[0], begin, end);
+            float globalVelocity = GetEmitterGlobalVelocity(_parentEffect->GetCurrentEffectFrame());
+            for (int i = begin; i < end; ++i)
+            {
+                Particle *e = particles[i];
+                e->_speed = cb.velocity[i] * e->_baseSpeed * globalVelocity;
+                e->_speed += e->_randomSpeed;
+            }
         }
         else
         {
-            e->_speed = e->_randomSpeed;
+            for (int i = begin; i < end; ++i)
+                particles[i]->_speed = particles[i]->_randomSpeed;
         }
 
         // stretch
-        if (!_bypassStretch)
+        if (!(Flags & ControlNoStretch))
         {
-            if (!_bypassWeight && !_parentEffect->IsBypassWeight())
+            if (!(Flags & ControlNoWeight) && !_parentEffect->IsBypassWeight())
             {
-                if (e->_speed != 0)
+                for (int i = begin; i < end; ++i)
                 {
-                    e->_speedVec.x = e->_speedVec.x / EffectsLibrary::GetCurrentUpdateTime();
-                    e->_speedVec.y = e->_speedVec.y / EffectsLibrary::GetCurrentUpdateTime() - e->_gravity;
+                    Particle *e = particles[i];
+                    if (e->_speed != 0)
+                    {
+                        e->_speedVec.x = e->_speedVec.x / currentUpdateTime;
+                        e->_speedVec.y = e->_speedVec.y / currentUpdateTime - e->_gravity;
+                    }
+                    else
+                    {
+                        e->_speedVec.x = 0;
+                        e->_speedVec.y = -e->_gravity;
+                    }
                 }
-                else
+            }
+
+            SampleColumn(table, EmitterTable::Stretch, _cStretch, ages, rows, &cb.stretch[0], begin, end);
+            float effectStretch = _parentEffect->GetCurrentStretch();
+            if (_uniform)
+            {
+                for (int i = begin; i < end; ++i)
                 {
-                    e->_speedVec.x = 0;
-                    e->_speedVec.y = -e->_gravity;
+                    Particle *e = particles[i];
+                    e->_scaleY = (cb.scaleX[i] * e->_gSizeX * (e->_width + (fabsf(e->_speed) * cb.stretch[i] * effectStretch))) / imageWidth;
+                    if (e->_scaleY < e->_scaleX)
+                        e->_scaleY = e->_scaleX;
                 }
+            }
+            else
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    Particle *e = particles[i];
+                    e->_scaleY = (cb.scaleY[i] * e->_gSizeY * (e->_height + (fabsf(e->_speed) * cb.stretch[i] * effectStretch))) / imageHeight;
+                    if (e->_scaleY < e->_scaleX)
+                        e->_scaleY = e->_scaleX;
+                }
+            }
+        }
 
-                if (_uniform)
-                    e->_scaleY = (GetEmitterScaleX(e->_age, (float)e->_lifeTime) * e->_gSizeX * (e->_width + (fabsf(e->_speed) * GetEmitterStretch(e->_age, (float)e->_lifeTime) * _parentEffect->GetCurrentStretch()))) / _image->GetWidth();
-                else
-                    e->_scaleY = (GetEmitterScaleY(e->_age, (float)e->_lifeTime) * e->_gSizeY * (e->_height + (fabsf(e->_speed) * GetEmitterStretch(e->_age, (float)e->_lifeTime) * _parentEffect->GetCurrentStretch()))) / _image->GetHeight();
+        // weight changes
+        if (!(Flags & ControlNoWeight))
+        {
+            SampleColumn(table, EmitterTable::Weight, _cWeight, ages, rows, &cb.weight[0], begin, end);
+            for (int i = begin; i < end; ++i)
+                particles[i]->_weight = cb.weight[i] * particles[i]->_baseWeight;
+        }
+    }
+
+    void Emitter::ControlAlignedAngle( Particle *e )
+    {
+        if (e->_directionLocked)
+        {
+            e->_angle = _parentEffect->GetAngle() + _angle + _angleOffset;
+        }
+        else
+        {
+            if (!_bypassWeight && (!_parentEffect->IsBypassWeight() || e->_direction))
+            {
+                if (e->_oldWX != e->_wx && e->_oldWY != e->_wy)
+                {
+                    if (e->_relative)
+                        e->_angle = Vector2::GetDirection(e->_oldX, e->_oldY, e->_x, e->_y);
+                    else
+                        e->_angle = Vector2::GetDirection(e->_oldWX, e->_oldWY, e->_wx, e->_wy);
+
+                    if (fabsf(e->_oldAngle - e->_angle) > 180)
+                    {
+                        if (e->_oldAngle > e->_angle)
+                            e->_oldAngle -= 360;
+                        else
+                            e->_oldAngle += 360;
+                    }
+                }
             }
             else
             {
-                if (_uniform)
-                    e->_scaleY = (GetEmitterScaleX(e->_age, (float)e->_lifeTime) * e->_gSizeX * (e->_width + (fabsf(e->_speed) * GetEmitterStretch(e->_age, (float)e->_lifeTime) * _parentEffect->GetCurrentStretch()))) / _image->GetWidth();
-                else
-                    e->_scaleY = (GetEmitterScaleY(e->_age, (float)e->_lifeTime) * e->_gSizeY * (e->_height + (fabsf(e->_speed) * GetEmitterStretch(e->_age, (float)e->_lifeTime) * _parentEffect->GetCurrentStretch()))) / _image->GetHeight();
+                e->_angle = e->_direction + _angle + _angleOffset;
+            }
+        }
+    }
+
+    void Emitter::ControlLockedDirection( Particle *e )
+    {
+        e->_direction = 90;
+        switch (_parentEffect->GetClass())
+        {
+        case Effect::TypeLine:
+            if (_parentEffect->GetDistanceSetByLife())
+            {
+                float life = e->_age / e->_lifeTime;
+                e->_x = (life * _parentEffect->GetCurrentWidth()) - _parentEffect->GetHandleX();
+            }
+            else
+            {
+                switch (_parentEffect->GetEndBehavior())
+                {
+                case Effect::EndKill:
+                    if (e->_x > _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX() || e->_x < 0 - _parentEffect->GetHandleX())
+                        e->_dead = 2;
+                    break;
+
+                case Effect::EndLoopAround:
+                    if (e->_x > _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX())
+                    {
+                        e->_x = (float)(-_parentEffect->GetHandleX());
+                        e->MiniUpdate();
+                        e->_oldX = e->_x;
+                        e->_oldWX = e->_wx;
+                        e->_oldWY = e->_wy;
+                    }
+                    else if (e->_x < 0 - _parentEffect->GetHandleX())
+                    {
+                        e->_x = _parentEffect->GetCurrentWidth() - _parentEffect->GetHandleX();
+                        e->MiniUpdate();
+                        e->_oldX = e->_x;
+                        e->_oldWX = e->_wx;
+                        e->_oldWY = e->_wy;
+                    }
+                    break;
+                case Effect::EndLetFree:
+                    break;
+                }
             }
+            break;
+        default:
+            break;
+        }
+    }
 
-            if (e->_scaleY < e->_scaleX)
-                e->_scaleY = e->_scaleX;
+    template <unsigned int Flags>
+    struct Emitter::ControlKernels
+    {
+        static void Fill(ChunkMethod *kernels)
+        {
+            ControlKernels<Flags - 1>::Fill(kernels);
+            kernels[Flags] = &Emitter::ApplyControlChunk<Flags>;
         }
+    };
 
-        // weight changes
-        if (!_bypassWeight)
-            e->_weight = GetEmitterWeight(e->_age, (float)e->_lifeTime) * e->_baseWeight;
+    template <>
+    struct Emitter::ControlKernels<0>
+    {
+        static void Fill(ChunkMethod *kernels)
+        {
+            kernels[0] = &Emitter::ApplyControlChunk<0>;
+        }
+    };
+
+    Emitter::ChunkMethod Emitter::GetControlKernel( unsigned int flags )
+    {
+        struct Table
+        {
+            ChunkMethod kernels[ControlKernelCount];
+
+            Table() { ControlKernels<ControlKernelCount - 1>::Fill(kernels); }
+        };
+        static const Table table;
+        return table.kernels[flags];
     }
 
     float Emitter::RandomizeR( Particle *e, float randomAge )
@@ -1796,6 +2434,9 @@ namespace TLFX
         _cDirectionVariationOT->CompileOT(longestLife);
         _cFramerate->CompileOT(longestLife);
         _cStretch->CompileOT(longestLife);
+        const EmitterArray* columns[EmitterTable::ColumnCount];
+        GetTableColumns(columns);
+        _table->Compile(columns);
         // global adjusters
         _cGlobalVelocity->Compile();
 
@@ -1808,10 +2449,40 @@ namespace TLFX
         AnalyseEmitter();
     }
 
+    void Emitter::GetArrays( EmitterArray* arrays[arrayCount] ) const
+    {
+        EmitterArray* const all[arrayCount] =
+        {
+            _cR, _cG, _cB, _cBaseSpin, _cSpin, _cSpinVariation, _cVelocity, _cBaseWeight, _cWeight, _cWeightVariation,
+            _cBaseSpeed, _cVelVariation, _cAlpha, _cSizeX, _cSizeY, _cScaleX, _cScaleY, _cSizeXVariation, _cSizeYVariation, _cLifeVariation,
+            _cLife, _cAmount, _cAmountVariation, _cEmissionAngle, _cEmissionRange, _cGlobalVelocity, _cDirection, _cDirectionVariation, _cDirectionVariationOT, _cFramerate,
+            _cStretch, _cSplatter
+        };
+        for (int i = 0; i < arrayCount; ++i)
+            arrays[i] = all[i];
+    }
+
+    void Emitter::GetTableColumns( const EmitterArray* columns[EmitterTable::ColumnCount] ) const
+    {
+        const EmitterArray* const all[EmitterTable::ColumnCount] =
+        {
+            _cAlpha, _cR, _cG, _cB, _cScaleX, _cScaleY, _cSpin, _cVelocity, _cWeight, _cDirection, _cDirectionVariationOT, _cFramerate, _cStretch
+        };
+        for (int c = 0; c < EmitterTable::ColumnCount; ++c)
+            columns[c] = all[c];
+    }
+
+    EmitterTable* Emitter::GetTable() const
+    {
+        return _table;
+    }
+
     void Emitter::CompileQuick()
     {
         float longestLife = GetLongestLife();
 
+        _table->Clear();
+
         _cAlpha->Clear(1);
         _cAlpha->SetCompiled(0, GetEmitterAlpha(0, longestLife));
 
@@ -1893,6 +2564,8 @@ namespace TLFX
 
         if (_cScaleY->GetAttributesCount() <= 1)
             _bypassScaleY = true;
+
+        SelectControlKernel();
     }
 
     void Emitter::ResetBypassers()
@@ -1911,6 +2584,30 @@ namespace TLFX
         _bypassFramerate = false;
         _bypassStretch = false;
         _bypassSplatter = false;
+
+        SelectControlKernel();
+    }
+
+    void Emitter::SelectControlKernel()
+    {
+        unsigned int flags = 0;
+        if (_bypassWeight)
+            flags |= ControlNoWeight;
+        if (_bypassSpeed)
+            flags |= ControlNoSpeed;
+        if (_bypassSpin)
+            flags |= ControlNoSpin;
+        if (_bypassColor)
+            flags |= ControlNoColor;
+        if (_bypassScaleX)
+            flags |= ControlNoScaleX;
+        if (_bypassScaleY)
+            flags |= ControlNoScaleY;
+        if (_bypassFramerate)
+            flags |= ControlNoFramerate;
+        if (_bypassStretch)
+            flags |= ControlNoStretch;
+        _controlKernel = GetControlKernel(flags);
     }
 
     float Emitter::GetLongestLife() const
@@ -136,6 +136,8 @@
 #include "TLFXEntity.h"
 #include "TLFXAttributeNode.h"
 #include "TLFXEmitterArray.h"
+#include "TLFXEmitterTable.h"
+#include "TLFXKernels.h"
 
 #include <list>
 #include <vector>
@@ -527,6 +529,7 @@ namespace TLFX
          * will take the values from the emitters own emission attributes.
          */
         void SetUseEffectEmission(bool value);
+        bool IsUseEffectEmission() const;
 
         /**
          * Set to FALSE to stop drawing the particles this emitter spawns
@@ -782,6 +785,12 @@ namespace TLFX
 
         virtual void Destroy(bool releaseChildren = true);
 
+        /**
+         * Restart a pooled emitter as a copy of the emitter passed to it
+         * The emitter must be dead. It keeps its sub effects, so the emitter passed to it must be a copy of the same library emitter.
+         */
+        void Reuse(const Emitter& other, ParticleManager *pm);
+
         /**
          * Change the dob of the emitter. dob being date of birth, or time it was created.
          * This will also change the dob of any effects the emitter contains. This is more of an internal method used by
@@ -802,12 +811,49 @@ namespace TLFX
          */
         void UpdateSpawns(Particle *eSingle = NULL);
 
+        /**
+         * Update all the particles of the emitter
+         * This does the same as updating each particle in turn, but the motion of all particles is integrated at once with Kernels::Integrate.
+         * When the particle manager has a TaskPool (see ParticleManager::SetUpdateThreads), large emitters are processed in chunks of
+         * #particleChunk particles in parallel; particles are only released and their bounds accumulated in the serial part, in order.
+         * This method is called by #Update each frame.
+         */
+        void UpdateParticles();
+
         /**
          * Control a particle
          * Any particle spawned by an emitter is controlled by it. When a particle is updated it calls this method to find out how it should behave.
          */
         void ControlParticle(Particle *particle);
 
+        /**
+         * Control a batch of particles
+         * Same as calling #ControlParticle for each particle in turn, but each over-time attribute is sampled for all the particles at once,
+         * from the compiled table or with EmitterArray::GetOTBatch, before it is applied to each particle. Like in #UpdateParticles, sampling
+         * and applying are done in parallel chunks for large batches.
+         */
+        void ControlParticles(Particle* const *particles, int count);
+
+        /**
+         * Whether the particles of the emitter can be fast-forwarded by ParticleManager::AddPreLoadedEffect
+         * That is when their motion isn't random, they don't spawn sub effects and the over-time attributes are in the EmitterTable.
+         */
+        bool CanFastForward() const;
+
+        /**
+         * Bring the particles of a fast-forward preload up to date
+         * While the particle manager fast-forwards, the particles of emitters that #CanFastForward are only aged. This replays their ticks
+         * from the EmitterTable rows: position, gravity, angle and animation frame are still accumulated tick by tick, but without the
+         * spawning, the sub effects and the full control of a regular update. Only when the velocity, direction, weight, spin and framerate
+         * curves are constant and the global velocity and spin don't change over the pre load are the remaining ticks added up at once
+         * (a constant-curve shortcut, not a closed form of curves that change over the particle's life). The particles are then controlled
+         * once at their age. Emitters that can't be fast-forwarded were stepped normally and only pass the call on to the sub effects of
+         * their particles.
+         */
+        void FastForwardParticles();
+
+        static const int particleChunk = 2048;  // particles per task when an emitter splits its particles between threads
+
         /**
          * Draws the current image frame
          * Draws on screen the current frame of the image the emitter uses to create particles with. Mainly just a Timeline Particles Editor method.
@@ -825,6 +871,19 @@ namespace TLFX
         void AnalyseEmitter();
         void ResetBypassers();
 
+        static const int arrayCount = 32;
+
+        /**
+         * Get the attribute arrays of the emitter, always in the same order (the one CompiledLibrary saves them in)
+         */
+        void GetArrays(EmitterArray* arrays[arrayCount]) const;
+
+        /**
+         * Get the over time arrays in the order of the columns of the emitter table
+         */
+        void GetTableColumns(const EmitterArray* columns[EmitterTable::ColumnCount]) const;
+        EmitterTable* GetTable() const;
+
         float GetLongestLife() const;
 
         // base
@@ -868,6 +927,8 @@ namespace TLFX
         bool IsDying() const;
 
     protected:
+        friend class Effect;                    // pooled effects flag their emitters
+
         float                                   _currentLife;           /// the current life of the emitter as it will vary over time
         bool                                    _uniform;               /// whether it scales uniformly
         Effect*                                 _parentEffect;          /// the effect it belongs to
@@ -901,7 +962,87 @@ namespace TLFX
         bool                                    _once;                  /// Whether the particles of this emitter should animate just the once
         std::string                             _path;                  /// the path to the emitter for where in the effect hierarchy the emitter is
         bool                                    _dying;                 /// true if the emitter is in the process of dying ie, no longer spawning particles
+        IntegrateBatch                          _integrateBatch;        /// scratch buffers for UpdateParticles
+        std::vector<Particle*>                  _updateQueue;           /// particles being updated by UpdateParticles
+        std::vector<Particle*>                  _controlQueue;          /// particles left to control at the end of UpdateParticles
+
+        struct ControlBatch
+        {
+            std::vector<float>  age, lifetime, alphaAge, colorAge;
+            std::vector<float>  alpha, spin, directionVariation, direction, scaleX, scaleY;
+            std::vector<float>  r, g, b, framerate, velocity, stretch, weight;
+            std::vector<int>    row, alphaRow, colorRow;            // rows of _table
+
+            void Resize(int count);
+        };
+        ControlBatch                            _controlBatch;          /// scratch buffers for ControlParticles, one value per particle
+        Particle* const*                        _controlParticles;      /// particles being controlled by ControlParticles
+        bool                                    _lockedDirections;      /// whether particles with a locked direction were spawned
+
+        // the chunks of UpdateParticles and ControlParticles, each only touches the particles in [begin, end)
+        typedef void (Emitter::*ChunkMethod)(int begin, int end);
+        struct Chunks
+        {
+            Emitter*        emitter;
+            ChunkMethod     method;
+            int             count;
+        };
+        void ForEachChunk(int count, ChunkMethod method);
+        static void RunChunk(void *arg, int index);
+        void IntegrateChunk(int begin, int end);
+        void GatherControlChunk(int begin, int end);
+        void IndexRows(const EmitterTable *table, const float *ages, int *rows, int begin, int end) const;
+        void SampleColumn(const EmitterTable *table, int column, const EmitterArray *curve, const float *ages, const int *rows, float *out,
+                          int begin, int end) const;
+        void RandomizeMotion(Particle* const *particles, int count);
+
+        // the control kernels: ApplyControlChunk instantiated for each combination of bypassed attributes, AnalyseEmitter selects the
+        // one of the emitter so that the kernel only samples and applies the attributes the emitter needs. The settings that aren't
+        // bypassers (uniform, repeats, aligned angle, random color) pick between loops once per chunk
+        enum ControlFlags
+        {
+            ControlNoWeight         = 1 << 0,
+            ControlNoSpeed          = 1 << 1,
+            ControlNoSpin           = 1 << 2,
+            ControlNoColor          = 1 << 3,
+            ControlNoScaleX         = 1 << 4,
+            ControlNoScaleY         = 1 << 5,
+            ControlNoFramerate      = 1 << 6,
+            ControlNoStretch        = 1 << 7,
+            ControlKernelCount      = 1 << 8
+        };
+        template <unsigned int Flags> void ApplyControlChunk(int begin, int end);
+        template <unsigned int Flags> struct ControlKernels;
+        static ChunkMethod GetControlKernel(unsigned int flags);
+        void SelectControlKernel();
+        void ControlAlignedAngle(Particle *e);
+        void ControlLockedDirection(Particle *e);
+
+        // fast-forward (see #FastForwardParticles)
+        struct FastForwardTick
+        {
+            float   globalVelocity;         // GetEmitterGlobalVelocity at the tick
+            float   spin;                   // and the current spin of the parent effect
+        };
+        std::vector<FastForwardTick>            _fastForwardTicks;      /// one per tick aged by AgeParticles
+        bool                                    _fastForwardConstant;   /// whether all _fastForwardTicks are the same
+        void AgeParticles();
+        bool ReplayParticle(Particle *e);                                                   // the ticks of a particle from the table rows
+        void SkipConstantTicks(Particle *e, int ticks, const FastForwardTick& tick);      // constant-curve shortcut, adds up the ticks left
+        void ControlFastForward(Particle *e, const float *row, const FastForwardTick& tick);
+        static void AdvanceFrame(Particle *e, float frames);
+
+        // random values come from the generator of the parent effect instead of rand(), see #Effect::SetSeed
+        float Rnd(float range);
+        float Rnd(float min, float max);
+
+        /**
+         * Copy the settings of another emitter, like the copy constructor but without the path and the sub effects
+         */
+        void Assign(const Emitter& o);
+
         bool                                    _groupParticles;        /// Set to true to add particles to one big pool, instead of the emitters own pool.
+        bool                                    _pooled;                /// Part of a pooled effect (see ParticleManager::GrabEffect), the sub effects are kept from one life to the next
 
         // ----All the lists for controlling the particle over time
         EmitterArray*                           _cR;                    /// Red
@@ -937,6 +1078,7 @@ namespace TLFX
         EmitterArray*                           _cFramerate;            /// the speed of the animation over time
         EmitterArray*                           _cStretch;              /// amount the particle is stretched by the speed it's traveling
         EmitterArray*                           _cSplatter;             /// this will randomize the distance where the particle spawns to it's point.
+        EmitterTable*                           _table;                 /// the over time arrays interleaved, shared like the arrays
         bool                                    _arrayOwner;            /// only the effects/emitters in EffectsLibrary should be the owners, not the copies
 
         // Bypassers
@@ -954,6 +1096,7 @@ namespace TLFX
         bool                                    _bypassFramerate;
         bool                                    _bypassStretch;
         bool                                    _bypassSplatter;
+        ChunkMethod                             _controlKernel;         /// ApplyControlChunk for the bypassers above
 
         // Bounding Box Info
         float                                   _AABB_ParticleMaxWidth;
@@ -1,5 +1,6 @@
 #include "TLFXEmitterArray.h"
 #include "TLFXEffectsLibrary.h"
+#include "TLFXKernels.h"
 
 #include <cassert>
 #include <algorithm>
@@ -9,17 +10,55 @@ namespace TLFX
 {
 
     EmitterArray::EmitterArray(float min, float max)
-        : _life(0)
+        : _ascending(true)
+        , _changes(NULL)
+        , _changesCount(0)
+        , _life(0)
         , _compiled(false)
         , _min(min)
         , _max(max)
+        , _version(0)
+        , _shape(Tabled)
+        , _slope(0)
     {
 
     }
 
+    EmitterArray::EmitterArray( const EmitterArray& o )
+        : _ascending(true)
+        , _changes(NULL)
+        , _changesCount(0)
+        , _version(0)
+        , _shape(Tabled)
+        , _slope(0)
+    {
+        *this = o;
+    }
+
+    EmitterArray& EmitterArray::operator=( const EmitterArray& o )
+    {
+        if (this == &o)
+            return *this;
+
+        _attributes = o._attributes;
+        _ascending = o._ascending;
+        _storage = o._storage;
+        // values set with SetCompiledData stay shared, our own ones are copied
+        _changes = o._changes == o._storage.data() ? _storage.data() : o._changes;
+        _changesCount = o._changesCount;
+        _life = o._life;
+        _compiled = o._compiled;
+        _min = o._min;
+        _max = o._max;
+        _shape = o._shape;
+        _slope = o._slope;
+        ++_version;
+        return *this;
+    }
+
     unsigned int EmitterArray::GetLastFrame() const
     {
-        return _changes.size() - 1;
+        return _changesCount - 1;
     }
 
     float EmitterArray::GetCompiled( unsigned int frame ) const
@@ -37,23 +76,59 @@ namespace TLFX
 
     void EmitterArray::SetCompiled( unsigned int frame, float value )
     {
-        assert(frame >= 0 && frame < _changes.size());
-        if (frame >= 0 && frame < _changes.size())
-            _changes[frame] = value;
+        assert(frame < _changesCount);
+        if (frame < _changesCount)
+            WritableCompiled()[frame] = value;
+        _shape = _changesCount == 1 ? Constant : Tabled;      // Compile and CompileOT classify the values once they're all set
+        ++_version;
     }
 
     float& EmitterArray::operator[]( unsigned int index )
     {
-        assert(index >= 0 && index < _changes.size());
-        return _changes[index];
+        assert(index < _changesCount);
+        ++_version;                     // the caller may write through the reference
+        _shape = Tabled;
+        return WritableCompiled()[index];
     }
 
     const float& EmitterArray::operator[]( unsigned int index ) const
     {
-        assert(index >= 0 && index < _changes.size());
+        assert(index < _changesCount);
         return _changes[index];
     }
 
+    void EmitterArray::SetCompiledData( const float *changes, unsigned int count, int life )
+    {
+        _storage.clear();
+        _changes = count ? changes : NULL;
+        _changesCount = count;
+        _life = life;
+        _compiled = true;
+        Classify();
+        ++_version;
+    }
+
+    const float* EmitterArray::GetCompiledData() const
+    {
+        return _changes;
+    }
+
+    void EmitterArray::ResizeCompiled( unsigned int count )
+    {
+        if (_changes != _storage.data())
+            _storage.assign(_changes, _changes + _changesCount);
+        _storage.resize(count);
+        _changes = _storage.data();
+        _changesCount = count;
+    }
+
+    float* EmitterArray::WritableCompiled()
+    {
+        if (_changes != _storage.data())
+            ResizeCompiled(_changesCount);
+        return &_storage[0];
+    }
+
     int EmitterArray::GetLife() const
     {
         return _life;
@@ -62,6 +137,56 @@ namespace TLFX
     void EmitterArray::SetLife( int life )
     {
         _life = life;
+        ++_version;
+    }
+
+    bool EmitterArray::IsCompiled() const
+    {
+        return _compiled && _changesCount > 0;
+    }
+
+    unsigned int EmitterArray::GetVersion() const
+    {
+        return _version;
+    }
+
+    EmitterArray::Shape EmitterArray::GetShape() const
+    {
+        return IsCompiled() ? _shape : Tabled;
+    }
+
+    float EmitterArray::GetSlope() const
+    {
+        return _shape == Linear ? _slope : 0;
+    }
+
+    void EmitterArray::Classify()
+    {
+        _shape = Tabled;
+        _slope = 0;
+        if (_changesCount == 0)
+            return;
+
+        float first = _changes[0], last = _changes[_changesCount - 1];
+        bool constant = true;
+        for (unsigned int i = 1; i < _changesCount && constant; ++i)
+            constant = _changes[i] == first;
+        if (constant)
+        {
+            _shape = Constant;
+            return;
+        }
+
+        // the values are interpolated in floats, a line is only straight up to their rounding
+        float slope = (last - first) / (_changesCount - 1);
+        float tolerance = fabsf(last - first) * 1e-4f;
+        for (unsigned int i = 1; i < _changesCount - 1; ++i)
+        {
+            if (fabsf(_changes[i] - (first + i * slope)) > tolerance)
+                return;
+        }
+        _shape = Linear;
+        _slope = slope;
     }
 
     void EmitterArray::Compile()
@@ -78,22 +203,17 @@ namespace TLFX
                 age += lookupFrequency;
             }
             */
-            _changes.resize(frame+1);
-            frame = 0;
-            float age = 0;
-            while (age < lastec->frame)
-            {
-                SetCompiled(frame, Interpolate(age));
-                ++frame;
-                age = frame * lookupFrequency;
-            }
+            ResizeCompiled(frame+1);
+            frame = CompileNodes(1.0f, lastec->frame, lookupFrequency);
             SetCompiled(frame, lastec->value);
         }
         else
         {
-            _changes.resize(1);
+            ResizeCompiled(1);
         }
         _compiled = true;
+        Classify();
+        ++_version;
     }
 
     void EmitterArray::CompileOT(float longestLife)
@@ -110,23 +230,48 @@ namespace TLFX
                 age += lookupFrequency;
             }
             */
-            _changes.resize(frame+1);
-            frame = 0;
-            float age = 0;
-            while (age < longestLife)
-            {
-                SetCompiled(frame, InterpolateOT(age, longestLife));
-                ++frame;
-                age = frame * lookupFrequency;
-            }
+            ResizeCompiled(frame+1);
+            frame = CompileNodes(longestLife, longestLife, lookupFrequency);
             SetCompiled(frame, lastec->value);
             SetLife((int)longestLife);
         }
         else
         {
-            _changes.resize(1);
+            ResizeCompiled(1);
         }
         _compiled = true;
+        Classify();
+        ++_version;
+    }
+
+    int EmitterArray::CompileNodes( float lifetime, float end, float lookupFrequency )
+    {
+        // a single pass: the ages only grow, so the node of an age is found from the node of the previous one, and once they are past
+        // the last node all the values are the last one
+        float *changes = &_storage[0];
+        unsigned int count = _changesCount, nodeCount = (unsigned int)_attributes.size();
+        bool ordered = _ascending && lifetime >= 0;
+        int frame = 0;
+        float age = 0;
+        unsigned int node = 0;
+        while (age < end && (unsigned int)frame < count)
+        {
+            node = NextNode(node, age, lifetime);
+            if (node == nodeCount && ordered)
+                break;
+            changes[frame] = InterpolateNode(node, age, lifetime, true);
+            ++frame;
+            age = frame * lookupFrequency;
+        }
+
+        float lastValue = _attributes.back().value;
+        while (age < end && (unsigned int)frame < count)
+        {
+            changes[frame] = lastValue;
+            ++frame;
+            age = frame * lookupFrequency;
+        }
+        return frame;
     }
 
     void EmitterArray::CompileOT()
@@ -136,14 +281,18 @@ namespace TLFX
 
     void EmitterArray::Sort()
     {
-        _attributes.sort();
-        //std::sort_heap(_attributes.begin(), _attributes.end());
+        std::stable_sort(_attributes.begin(), _attributes.end());
+        CheckAscending();
         _compiled = false;
+        ++_version;
     }
 
     AttributeNode* EmitterArray::Add( float frame, float value )
     {
         _compiled = false;
+        ++_version;
+
+        _ascending = _ascending && (_attributes.empty() || frame >= _attributes.back().frame);
 
         AttributeNode e;
         e.frame = frame;
@@ -155,7 +304,9 @@ namespace TLFX
     void EmitterArray::Clear(unsigned int size /*= 0*/)
     {
         _attributes.resize(size);
+        CheckAscending();
         _compiled = true;
+        ++_version;
     }
 
     float EmitterArray::GetBezierValue( const AttributeNode& lastec, const AttributeNode& a, float t, float yMin, float yMax )
@@ -237,37 +388,71 @@ namespace TLFX
 
     float EmitterArray::InterpolateOT( float age, float lifetime, bool bezier /*= true*/ ) const
     {
-        float lasty = 0;
-        float lastf = 0;
-        const AttributeNode* lastec = NULL;
+        return InterpolateNode(FindNode(age, lifetime), age, lifetime, bezier);
+    }
 
-        for (auto it = _attributes.begin(); it != _attributes.end(); ++it)
+    void EmitterArray::CheckAscending()
+    {
+        _ascending = true;
+        for (size_t i = 1; i < _attributes.size() && _ascending; ++i)
+            _ascending = _attributes[i].frame >= _attributes[i - 1].frame;
+    }
+
+    unsigned int EmitterArray::FindNode( float age, float lifetime ) const
+    {
+        // the first node past the age, the one the interpolation ends at
+        if (_ascending && lifetime >= 0)
+        {
+            auto it = std::upper_bound(_attributes.begin(), _attributes.end(), age,
+                                       [lifetime](float a, const AttributeNode& n) { return a < n.frame * lifetime; });
+            return (unsigned int)(it - _attributes.begin());
+        }
+
+        for (unsigned int i = 0; i < _attributes.size(); ++i)
+        {
+            if (age < _attributes[i].frame * lifetime)
+                return i;
+        }
+        return (unsigned int)_attributes.size();
+    }
+
+    unsigned int EmitterArray::NextNode( unsigned int node, float age, float lifetime ) const
+    {
+        if (!(_ascending && lifetime >= 0))
+            return FindNode(age, lifetime);
+
+        while (node < _attributes.size() && !(age < _attributes[node].frame * lifetime))
+            ++node;
+        return node;
+    }
+
+    float EmitterArray::InterpolateNode( unsigned int node, float age, float lifetime, bool bezier ) const
+    {
+        if (node >= _attributes.size())
+            return _attributes.empty() ? 0 : _attributes.back().value;
+
+        const AttributeNode& a = _attributes[node];
+        const AttributeNode* lastec = node > 0 ? &_attributes[node - 1] : NULL;
+        float lasty = lastec ? lastec->value : 0;
+        float lastf = lastec ? lastec->frame * lifetime : 0;
+        float frame = a.frame * lifetime;
+
+        float p = float(age - lastf) / (frame - lastf);
+        if (bezier && lastec)
         {
-            float frame = it->frame * lifetime;
-            if (age < frame)
+            float bezierValue = GetBezierValue(*lastec, a, p, _min, _max);
+            if (bezierValue != 0)
             {
-                float p = float(age - lastf) / (frame - lastf);
-                if (bezier)
-                {
-                    float bezierValue = GetBezierValue(*lastec, *it, p, _min, _max);
-                    if (bezierValue != 0)
-                    {
-                        return bezierValue;
-                    }
-                }
-                return lasty - p * (lasty - it->value);
+                return bezierValue;
             }
-            lasty = it->value;
-            lastf = frame/* - 1*/;
-            if (bezier) lastec = &(*it);
         }
-        return lasty;
+        return lasty - p * (lasty - a.value);
     }
 
     float EmitterArray::Get( float frame, bool bezier /*= true*/ ) const
     {
         if (_compiled)
-            return GetCompiled((unsigned int)frame);
+            return _shape == Constant ? _changes[0] : GetCompiled((unsigned int)frame);
         else
             return Interpolate(frame, bezier);
     }
@@ -279,6 +464,9 @@ namespace TLFX
 
     float EmitterArray::GetOT( float age, float lifetime, bool bezier /*= true*/ ) const
     {
+        if (_compiled && _shape == Constant)
+            return _changes[0];
+
         float frame = 0;
         if (lifetime > 0)
         {
@@ -292,11 +480,33 @@ namespace TLFX
         return GetOT(age, lifetime);
     }
 
+    void EmitterArray::GetOTBatch( const float *ages, const float *lifetimes, float *out, int count ) const
+    {
+        if (_compiled && _shape == Constant)
+        {
+            std::fill(out, out + count, _changes[0]);
+        }
+        else if (_compiled && _changesCount > 0)
+        {
+            Kernels::SampleOverTime(_changes, GetLastFrame(), (float)_life, EffectsLibrary::GetLookupFrequencyOverTime(), ages, lifetimes, out, count);
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+                out[i] = GetOT(ages[i], lifetimes[i]);
+        }
+    }
+
     unsigned int EmitterArray::GetAttributesCount() const
     {
         return _attributes.size();
     }
 
+    const std::vector<AttributeNode>& EmitterArray::GetAttributes() const
+    {
+        return _attributes;
+    }
+
     float EmitterArray::GetMaxValue() const
     {
         float max = 0;
@@ -8,7 +8,6 @@
 #include "TLFXAttributeNode.h"
 
 #include <vector>
-#include <list>
 
 namespace TLFX
 {
@@ -16,21 +15,45 @@ namespace TLFX
     class EmitterArray
     {
     public:
+        /**
+         * What the compiled values of an array look like, see #GetShape
+         */
+        enum Shape
+        {
+            Tabled,             // anything else, the values are looked up
+            Linear,             // the values follow a straight line: value i is about GetCompiled(0) + i * GetSlope()
+            Constant            // all the values are the same, GetCompiled(0)
+        };
+
         EmitterArray(float min, float max);
+        EmitterArray(const EmitterArray& o);
+        EmitterArray& operator=(const EmitterArray& o);
 
         void           Clear(unsigned int size = 0);
+
+        /**
+         * Add a node at the end of the array
+         * The node returned can be changed (eg. with AttributeNode::SetCurvePoints) until the next one is added, but not its frame.
+         */
         AttributeNode* Add(float frame, float value);
         float          Get(float frame, bool bezier = true) const;
         float          operator()(float frame, bool bezier = true) const;
         float          GetOT(float age, float lifetime, bool bezier = true) const;
         float          operator()(float age, float lifetime, bool bezier = true) const;
 
+        /**
+         * Same as #GetOT for count (age, lifetime) pairs at once
+         * Compiled arrays are sampled with Kernels::SampleOverTime.
+         */
+        void           GetOTBatch(const float *ages, const float *lifetimes, float *out, int count) const;
+
         float          Interpolate(float frame, bool bezier = true) const;
         float          InterpolateOT(float age, float lifetime, bool bezier = true) const;
 
         void           Sort();
 
         unsigned int   GetAttributesCount() const;
+        const std::vector<AttributeNode>& GetAttributes() const;
 
         float           GetMaxValue() const;
 
@@ -46,17 +69,58 @@ namespace TLFX
         float&         operator[](unsigned int frame);
         const float&   operator[](unsigned int frame) const;
 
+        /**
+         * Use count compiled values stored outside of the array, like in a mapped CompiledLibrary, instead of compiling it
+         * The values are not copied and must outlive the array, the array makes its own copy the first time they are written to.
+         */
+        void           SetCompiledData(const float *changes, unsigned int count, int life);
+        const float*   GetCompiledData() const;
+
         int            GetLife() const;
         void           SetLife(int life);
 
+        /**
+         * Whether the array holds compiled values that #Get can use
+         */
+        bool           IsCompiled() const;
+
+        /**
+         * Get the shape of the compiled values, classified when the array is compiled (Tabled if it isn't)
+         * Get, GetOT and GetOTBatch return a constant array's value without any lookup, and callers sampling many particles can read it
+         * once instead of once per particle. The linear shape is not used for the lookups since the line only matches the values
+         * approximately.
+         */
+        Shape          GetShape() const;
+        float          GetSlope() const;
+
+        /**
+         * Get a counter that changes every time the array is modified, used to know when caches built from the array are outdated
+         */
+        unsigned int   GetVersion() const;
+
     protected:
-        std::list<AttributeNode> _attributes;
+        std::vector<AttributeNode> _attributes;
+        bool                     _ascending;            // the frames of _attributes never decrease, so they can be searched
 
         // compiled
-        std::vector<float>       _changes;
+        std::vector<float>       _storage;
+        const float*             _changes;              // _storage, or the values given to SetCompiledData
+        unsigned int             _changesCount;
         int                      _life;
         bool                     _compiled;
         float                    _min, _max;
+        unsigned int             _version;
+        Shape                    _shape;
+        float                    _slope;                // per compiled value, for Linear arrays
+
+        void  ResizeCompiled(unsigned int count);
+        void  Classify();
+        void  CheckAscending();
+        int   CompileNodes(float lifetime, float end, float lookupFrequency);
+        unsigned int FindNode(float age, float lifetime) const;
+        unsigned int NextNode(unsigned int node, float age, float lifetime) const;
+        float InterpolateNode(unsigned int node, float age, float lifetime, bool bezier) const;
+        float* WritableCompiled();
 
         static float GetBezierValue(const AttributeNode& lastec, const AttributeNode& a, float t, float yMin, float yMax);
         static void GetQuadBezier(float p0x, float p0y, float p1x, float p1y, float p2x, float p2y, float t, float yMin, float yMax, float& outX, float& outY, bool clamp = true);
@@ -0,0 +1,117 @@
+#include "TLFXEmitterTable.h"
+#include "TLFXEmitterArray.h"
+
+#include <cstddef>
+
+namespace TLFX
+{
+
+    EmitterTable::EmitterTable()
+        : _rows(NULL)
+        , _rowCount(0)
+        , _life(0)
+        , _constant(0)
+        , _compiled(false)
+    {
+        for (int c = 0; c < ColumnCount; ++c)
+        {
+            _columns[c] = NULL;
+            _versions[c] = 0;
+        }
+    }
+
+    bool EmitterTable::Compile( const EmitterArray* const columns[ColumnCount] )
+    {
+        Clear();
+
+        // constant arrays have the same value whatever their life, all the others must share the life so that they share the rows
+        unsigned int rowCount = 1;
+        int life = 0;
+        bool lifeSet = false;
+        for (int c = 0; c < ColumnCount; ++c)
+        {
+            const EmitterArray *a = columns[c];
+            if (!a->IsCompiled())
+                return false;
+
+            unsigned int count = a->GetLastFrame() + 1;
+            if (count > 1 && a->GetShape() != EmitterArray::Constant)
+            {
+                if (lifeSet && a->GetLife() != life)
+                    return false;
+                life = a->GetLife();
+                lifeSet = true;
+                if (count > rowCount)
+                    rowCount = count;
+            }
+        }
+
+        _data.assign(rowCount * stride + stride - 1, 0);
+        size_t misalignment = ((size_t)&_data[0] / sizeof(float)) % stride;
+        float *rows = &_data[0] + (misalignment ? stride - misalignment : 0);
+        _rows = rows;
+        _rowCount = rowCount;
+        _life = life;
+
+        for (int c = 0; c < ColumnCount; ++c)
+        {
+            const EmitterArray *a = columns[c];
+            const float *values = a->GetCompiledData();
+            unsigned int last = a->GetLastFrame();
+            bool constant = true;
+            for (unsigned int r = 0; r < rowCount; ++r)
+            {
+                rows[r * stride + c] = values[r < last ? r : last];    // clamps to the last value of shorter arrays like GetOT does
+                constant = constant && rows[r * stride + c] == rows[c];
+            }
+            if (constant)
+                _constant |= 1u << c;
+
+            _columns[c] = a;
+            _versions[c] = a->GetVersion();
+        }
+
+        _compiled = true;
+        return true;
+    }
+
+    void EmitterTable::SetRows( const float *rows, unsigned int rowCount, int life, unsigned int constant, const EmitterArray* const columns[ColumnCount] )
+    {
+        Clear();
+
+        _rows = rows;
+        _rowCount = rowCount;
+        _life = life;
+        _constant = constant;
+        for (int c = 0; c < ColumnCount; ++c)
+        {
+            _columns[c] = columns[c];
+            _versions[c] = columns[c]->GetVersion();
+        }
+        _compiled = true;
+    }
+
+    void EmitterTable::Clear()
+    {
+        _data.clear();
+        _rows = NULL;
+        _rowCount = 0;
+        _life = 0;
+        _constant = 0;
+        _compiled = false;
+    }
+
+    bool EmitterTable::IsCurrent() const
+    {
+        if (!_compiled)
+            return false;
+
+        for (int c = 0; c < ColumnCount; ++c)
+        {
+            if (_columns[c]->GetVersion() != _versions[c] || !_columns[c]->IsCompiled())
+                return false;
+        }
+        return true;
+    }
+
+} // namespace TLFX
@@ -0,0 +1,93 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_EMITTERTABLE_H
+#define _TLFX_EMITTERTABLE_H
+
+#include <vector>
+
+namespace TLFX
+{
+
+    class EmitterArray;
+
+    /**
+     * Interleaved lookup table of the over-time attributes of an emitter
+     * <p>Each row holds the values of all the over-time attributes (alpha, color, scale, spin...) for one lookup step, so that controlling a
+     * particle only fetches a single 64 bytes row instead of one cache line per EmitterArray. The table is built from the compiled
+     * EmitterArrays by Emitter::CompileAll and is only a cache: the arrays stay the reference and can still be edited, the table is ignored
+     * as soon as one of them changes (see #IsCurrent) until it is compiled again.</p>
+     */
+    class EmitterTable
+    {
+    public:
+        enum Column
+        {
+            Alpha,
+            R, G, B,
+            ScaleX, ScaleY,
+            Spin,
+            Velocity,
+            Weight,
+            Direction,
+            DirectionVariation,
+            Framerate,
+            Stretch,
+            ColumnCount
+        };
+
+        static const int stride = 16;           // floats per row, a row is 64 bytes and aligned to 64 bytes
+
+        EmitterTable();
+
+        /**
+         * Build the table from compiled over-time arrays
+         * All arrays with more than one value must have been compiled for the same life (see EmitterArray::CompileOT).
+         * @return false if the table couldn't be built, in which case the arrays have to be sampled one by one
+         */
+        bool Compile(const EmitterArray* const columns[ColumnCount]);
+
+        /**
+         * Use rows stored outside of the table, like in a mapped CompiledLibrary, instead of building them
+         * The rows are not copied: they must be aligned to 64 bytes, hold what #Compile would build from the columns and outlive the table.
+         * @param constant Bit c set when column c holds the same value in every row
+         */
+        void SetRows(const float *rows, unsigned int rowCount, int life, unsigned int constant, const EmitterArray* const columns[ColumnCount]);
+
+        void Clear();
+
+        /**
+         * Whether the table is compiled and none of the arrays it was built from changed since
+         */
+        bool IsCurrent() const;
+
+        /**
+         * Get the life the rows were compiled for and the index of the last row
+         * A particle of age a and lifetime t is at row min(a / t * life / EffectsLibrary::GetLookupFrequencyOverTime(), last row).
+         */
+        int GetLife() const { return _life; }
+        unsigned int GetLastRow() const { return _rowCount - 1; }
+
+        const float* GetRow(unsigned int row) const { return _rows + row * stride; }
+
+        /**
+         * Whether a column holds the same value in every row
+         */
+        bool IsConstant(Column column) const { return (_constant & (1u << column)) != 0; }
+
+    protected:
+        std::vector<float>          _data;
+        const float*                _rows;                          // _data aligned to 64 bytes, or the rows given to SetRows
+        unsigned int                _rowCount;
+        int                         _life;
+        unsigned int                _constant;                      // bit c set when column c doesn't change
+        bool                        _compiled;
+
+        const EmitterArray*         _columns[ColumnCount];          // arrays the table was built from
+        unsigned int                _versions[ColumnCount];         // and their versions at that time
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_EMITTERTABLE_H
@@ -88,6 +88,7 @@ namespace TLFX
         , _entityRadius(0)
         , _imageDiameter(0)
 
+        , _unused(false)
         , _parent(NULL)
         , _rootParent(NULL)
 
@@ -100,125 +101,145 @@ namespace TLFX
 
         , _runChildren(false)
         , _pixelsPerSecond(0)
+
+        , _trigAngle(0)
+        , _trigAngleGeneration(Math::GetTrigGeneration())
+        , _angleSin(0), _angleCos(1.0f)
+        , _trigDirection(0)
+        , _trigDirectionGeneration(Math::GetTrigGeneration())
+        , _directionSin(0), _directionCos(1.0f)
     {
 
     }
 
     Entity::Entity( const Entity& o )
-        : _x(o._x)
-        , _y(o._y)
-        , _oldX(o._oldX)
-        , _oldY(o._oldY)
-        , _wx(o._wx)
-        , _wy(o._wy)
-        , _oldWX(o._oldWX)
-        , _oldWY(o._oldWY)
-        , _z(o._z)
-        , _oldZ(o._oldZ)
-        , _relative(o._relative)
-
-        , _matrix(o._matrix)
-        , _spawnMatrix(o._spawnMatrix)
-        , _rotVec(o._rotVec)
-        , _speedVec(o._speedVec)
-        , _gravVec(o._gravVec)
-
-        , _name(o._name)
-
-        , _r(o._r)
-        , _g(o._g)
-        , _b(o._b)
-        , _red(o._red)
-        , _green(o._green)
-        , _blue(o._blue)
-        , _oldRed(o._oldRed)
-        , _oldGreen(o._oldGreen)
-        , _oldBlue(o._oldBlue)
-
-        , _width(o._width)
-        , _height(o._height)
-        , _weight(o._weight)
-        , _gravity(o._gravity)
-        , _baseWeight(o._baseWeight)
-        , _oldWeight(o._oldWeight)
-        , _scaleX(o._scaleX)
-        , _scaleY(o._scaleY)
-        , _sizeX(o._sizeX)
-        , _sizeY(o._sizeY)
-        , _oldScaleX(o._oldScaleX)
-        , _oldScaleY(o._oldScaleY)
-
-        , _speed(o._speed)
-        , _baseSpeed(o._baseSpeed)
-        , _oldSpeed(o._oldSpeed)
-        , _updateSpeed(o._updateSpeed)
-
-        , _direction(o._direction)
-        , _directionLocked(o._directionLocked)
-        , _angle(o._angle)
-        , _oldAngle(o._oldAngle)
-        , _relativeAngle(o._relativeAngle)
-        , _oldRelativeAngle(o._oldRelativeAngle)
-
-        , _avatar(o._avatar)
-        , _frameOffset(o._frameOffset)
-        , _framerate(o._framerate)
-        , _currentFrame(o._currentFrame)
-        , _oldCurrentFrame(o._oldCurrentFrame)
-        , _animating(o._animating)
-        , _animateOnce(o._animateOnce)
-        , _animAction(o._animAction)
-        , _handleX(o._handleX)
-        , _handleY(o._handleY)
-        , _autoCenter(o._autoCenter)
-        , _okToRender(o._okToRender)
-
-        , _dob(o._dob)
-        , _age(o._age)
-        , _rptAgeA(o._rptAgeA)
-        , _rptAgeC(o._rptAgeC)
-        , _aCycles(o._aCycles)
-        , _cCycles(o._cCycles)
-        , _oldAge(o._oldAge)
-        , _dead(o._dead)
-        , _destroyed(o._destroyed)
-        , _lifeTime(o._lifeTime)
-        , _timediff(o._timediff)
-
-        , _AABB_Calculate(o._AABB_Calculate)
-        , _collisionXMin(o._collisionXMin)
-        , _collisionYMin(o._collisionYMin)
-        , _collisionXMax(o._collisionXMax)
-        , _collisionYMax(o._collisionYMax)
-        , _AABB_XMin(o._AABB_XMin)
-        , _AABB_YMin(o._AABB_YMin)
-        , _AABB_XMax(o._AABB_XMax)
-        , _AABB_YMax(o._AABB_YMax)
-        , _AABB_MaxWidth(o._AABB_MaxWidth)
-        , _AABB_MaxHeight(o._AABB_MaxHeight)
-        , _AABB_MinWidth(o._AABB_MinWidth)
-        , _AABB_MinHeight(o._AABB_MinHeight)
-        , _radiusCalculate(o._radiusCalculate)
-        , _imageRadius(o._imageRadius)
-        , _entityRadius(o._entityRadius)
-        , _imageDiameter(o._imageDiameter)
-
-        , _parent(NULL)
-        , _rootParent(NULL)
-
+        : _name(o._name)
         , _childrenOwner(o._childrenOwner)
+    {
+        // do not copy children as we don't know their type
+        // Emitter and Effect should take care about this
+        Assign(o);
+    }
+
+    void Entity::Assign( const Entity& o )
+    {
+        _x = o._x;
+        _y = o._y;
+        _oldX = o._oldX;
+        _oldY = o._oldY;
+        _wx = o._wx;
+        _wy = o._wy;
+        _oldWX = o._oldWX;
+        _oldWY = o._oldWY;
+        _z = o._z;
+        _oldZ = o._oldZ;
+        _relative = o._relative;
+
+        _matrix = o._matrix;
+        _spawnMatrix = o._spawnMatrix;
+        _rotVec = o._rotVec;
+        _speedVec = o._speedVec;
+        _gravVec = o._gravVec;
+
+        _r = o._r;
+        _g = o._g;
+        _b = o._b;
+        _red = o._red;
+        _green = o._green;
+        _blue = o._blue;
+        _oldRed = o._oldRed;
+        _oldGreen = o._oldGreen;
+        _oldBlue = o._oldBlue;
+
+        _width = o._width;
+        _height = o._height;
+        _weight = o._weight;
+        _gravity = o._gravity;
+        _baseWeight = o._baseWeight;
+        _oldWeight = o._oldWeight;
+        _scaleX = o._scaleX;
+        _scaleY = o._scaleY;
+        _sizeX = o._sizeX;
+        _sizeY = o._sizeY;
+        _oldScaleX = o._oldScaleX;
+        _oldScaleY = o._oldScaleY;
+
+        _speed = o._speed;
+        _baseSpeed = o._baseSpeed;
+        _oldSpeed = o._oldSpeed;
+        _updateSpeed = o._updateSpeed;
+
+        _direction = o._direction;
+        _directionLocked = o._directionLocked;
+        _angle = o._angle;
+        _oldAngle = o._oldAngle;
+        _relativeAngle = o._relativeAngle;
+        _oldRelativeAngle = o._oldRelativeAngle;
+
+        _avatar = o._avatar;
+        _frameOffset = o._frameOffset;
+        _framerate = o._framerate;
+        _currentFrame = o._currentFrame;
+        _oldCurrentFrame = o._oldCurrentFrame;
+        _animating = o._animating;
+        _animateOnce = o._animateOnce;
+        _animAction = o._animAction;
+        _handleX = o._handleX;
+        _handleY = o._handleY;
+        _autoCenter = o._autoCenter;
+        _okToRender = o._okToRender;
+
+        _dob = o._dob;
+        _age = o._age;
+        _rptAgeA = o._rptAgeA;
+        _rptAgeC = o._rptAgeC;
+        _aCycles = o._aCycles;
+        _cCycles = o._cCycles;
+        _oldAge = o._oldAge;
+        _dead = o._dead;
+        _destroyed = o._destroyed;
+        _lifeTime = o._lifeTime;
+        _timediff = o._timediff;
+
+        _AABB_Calculate = o._AABB_Calculate;
+        _collisionXMin = o._collisionXMin;
+        _collisionYMin = o._collisionYMin;
+        _collisionXMax = o._collisionXMax;
+        _collisionYMax = o._collisionYMax;
+        _AABB_XMin = o._AABB_XMin;
+        _AABB_YMin = o._AABB_YMin;
+        _AABB_XMax = o._AABB_XMax;
+        _AABB_YMax = o._AABB_YMax;
+        _AABB_MaxWidth = o._AABB_MaxWidth;
+        _AABB_MaxHeight = o._AABB_MaxHeight;
+        _AABB_MinWidth = o._AABB_MinWidth;
+        _AABB_MinHeight = o._AABB_MinHeight;
+        _radiusCalculate = o._radiusCalculate;
+        _imageRadius = o._imageRadius;
+        _entityRadius = o._entityRadius;
+        _imageDiameter = o._imageDiameter;
+
+        _unused = false;
+        _parent = NULL;
+        _rootParent = NULL;
 
-        , _blendMode(o._blendMode)
+        _blendMode = o._blendMode;
 
-        , _alpha(o._alpha)
-        , _oldAlpha(o._oldAlpha)
+        _alpha = o._alpha;
+        _oldAlpha = o._oldAlpha;
 
-        , _runChildren(o._runChildren)
+        _runChildren = o._runChildren;
 
-        , _pixelsPerSecond(o._pixelsPerSecond)
-    {
-        // do not copy children as we don't know their type
-        // Emitter and Effect should take care about this
+        _pixelsPerSecond = o._pixelsPerSecond;
+
+        _trigAngle = o._trigAngle;
+        _trigAngleGeneration = o._trigAngleGeneration;
+        _angleSin = o._angleSin;
+        _angleCos = o._angleCos;
+        _trigDirection = o._trigDirection;
+        _trigDirectionGeneration = o._trigDirectionGeneration;
+        _directionSin = o._directionSin;
+        _directionCos = o._directionCos;
     }
 
     bool Entity::IsDestroyed() const
@@ -240,12 +261,26 @@ namespace TLFX
     {
         float currentUpdateTime = EffectsLibrary::GetCurrentUpdateTime();
 
+        UpdateMotion(currentUpdateTime);
+        UpdateWorldMatrix();
+        UpdateWorldPosition();
+        UpdateFrameAndBounds(currentUpdateTime);
+
+        // update the children
+        UpdateChildren();
+
+        return true;
+    }
+
+    void Entity::UpdateMotion( float currentUpdateTime )
+    {
         // Update speed in pixels per second
         if (_updateSpeed && _speed)
         {
             _pixelsPerSecond = _speed / currentUpdateTime;
-            _speedVec.x = sinf(_direction / 180.0f * (float)M_PI) * _pixelsPerSecond;
-            _speedVec.y = cosf(_direction / 180.0f * (float)M_PI) * _pixelsPerSecond;
+            UpdateDirectionTrig();
+            _speedVec.x = _directionSin * _pixelsPerSecond;
+            _speedVec.y = _directionCos * _pixelsPerSecond;
 
             _x += _speedVec.x * _z;
             _y -= _speedVec.y * _z;
@@ -257,16 +292,30 @@ namespace TLFX
             _gravity += _weight / currentUpdateTime;
             _y += (_gravity / currentUpdateTime) * _z;
         }
+    }
 
+    void Entity::UpdateWorldMatrix()
+    {
         // set the matrix if it is relative to the parent
         if (_relative)
-            _matrix.Set(cosf(_angle / 180.f * (float)M_PI), sinf(_angle / 180.0f * (float)M_PI), -sinf(_angle / 180.0f * (float)M_PI), cosf(_angle / 180.0f * (float)M_PI));
+            UpdateRotationMatrix();
+
+        if (_parent && _relative)
+        {
+            _matrix = _matrix.Transform(_parent->_matrix);
+            _relativeAngle = _parent->_relativeAngle + _angle;
+        }
 
+        if (!_parent)
+            _relativeAngle = _angle;
+    }
+
+    void Entity::UpdateWorldPosition()
+    {
         // calculate where the entity is in the world
         if (_parent && _relative)
         {
             _z = _parent->_z;
-            _matrix = _matrix.Transform(_parent->_matrix);
             Vector2 rotVec = _parent->_matrix.TransformVector(Vector2(_x, _y));
             if (_z != 1.0f)
             {
@@ -278,7 +327,6 @@ namespace TLFX
                 _wx = _parent->_wx + rotVec.x;
                 _wy = _parent->_wy + rotVec.y;
             }
-            _relativeAngle = _parent->_relativeAngle + _angle;
         }
         else
         {
@@ -286,10 +334,10 @@ namespace TLFX
             _wx = _x;
             _wy = _y;
         }
+    }
 
-        if (!_parent)
-            _relativeAngle = _angle;
-
+    void Entity::UpdateFrameAndBounds( float currentUpdateTime )
+    {
         // update animation frame
         if (_avatar && _animating)
         {
@@ -314,11 +362,6 @@ namespace TLFX
         // update the radius of influence
         if (_radiusCalculate)
             UpdateEntityRadius();
-
-        // update the children
-        UpdateChildren();
-
-        return true;
     }
 
     void Entity::SetX(float x)
@@ -361,9 +404,15 @@ namespace TLFX
         return _matrix;
     }
 
+    void Entity::UpdateRotationMatrix()
+    {
+        UpdateAngleTrig();
+        _matrix.Set(_angleCos, _angleSin, -_angleSin, _angleCos);
+    }
+
     void Entity::MiniUpdate()
     {
-        _matrix.Set(cosf(_angle / 180.0f * (float)M_PI), sinf(_angle / 180.f * (float)M_PI), -sinf(_angle / 180.0f * (float)M_PI), cosf(_angle / 180.0f * (float)M_PI));
+        UpdateRotationMatrix();
 
         if (_parent && _relative)
         {
@@ -396,7 +445,7 @@ namespace TLFX
         {
             if (!(*it)->Update())
             {
-                if (_childrenOwner) delete *it;
+                if (_childrenOwner) (*it)->Dispose();
                 it = _children.erase(it);
             }
             else
@@ -579,7 +628,7 @@ namespace TLFX
         for (auto it = _children.begin(); it != _children.end(); ++it)
         {
             (*it)->Destroy(releaseChildren);
-            if (releaseChildren && _childrenOwner) delete *it;
+            if (releaseChildren && _childrenOwner) (*it)->Dispose();
         }
         _children.clear();
         _destroyed = true;
@@ -596,7 +645,7 @@ namespace TLFX
         for (auto it = _children.begin(); it != _children.end(); ++it)
         {
             (*it)->Destroy();
-            if (_childrenOwner) delete *it;
+            if (_childrenOwner) (*it)->Dispose();
         }
         _children.clear();
     }
@@ -859,7 +908,7 @@ namespace TLFX
         return _parent;
     }
 
-    const std::list<Entity*>& Entity::GetChildren() const
+    const Entity::ChildList& Entity::GetChildren() const
     {
         return _children;
     }
@@ -7,6 +7,8 @@
 
 #include "TLFXMatrix2.h"
 #include "TLFXVector2.h"
+#include "TLFXMath.h"
+#include "TLFXNodeAllocator.h"
 
 #include <list>
 #include <string>
@@ -46,6 +48,8 @@ namespace TLFX
             BMLightBlend,
         };
 
+        typedef std::list<Entity*, NodeAllocator<Entity*> > ChildList;  // the nodes are recycled, see NodeAllocator
+
         Entity();
 
         /**
@@ -153,6 +157,12 @@ namespace TLFX
          */
         virtual void Destroy(bool releaseMemory = true);
 
+        /**
+         * Free the entity
+         * The owners of the children call it instead of delete, so that the entities taken from a pool can go back there.
+         */
+        virtual void Dispose() { delete this; }
+
         /**
          * Remove a child entity from this entity's list of children
          */
@@ -447,7 +457,7 @@ namespace TLFX
         /**
          * Get the name of the entity
          */
-        const char *GetName() const;
+        virtual const char *GetName() const;
 
         /**
          * Gets the x and y scale of the entity.
@@ -470,7 +480,7 @@ namespace TLFX
          * Get the children that this entity has
          * This will return a list of children that the entity currently has
          */
-        const std::list<Entity*>& GetChildren() const;
+        const ChildList& GetChildren() const;
 
         /**
          * Get the lifetime value in this Entity object.
@@ -623,6 +633,7 @@ namespace TLFX
         const void SetUnused(bool value) { _unused = value; }
         bool IsUnused() const { return _unused; }
         
+        // rand() based, the emitters use the generator of their effect instead
         static float Rnd(float range);
         static float Rnd(float min, float max);
 
@@ -716,7 +727,7 @@ namespace TLFX
         Entity*                         _parent;                    // parent of the entity, for example bullet fired by the entity
         Entity*                         _rootParent;                // The root parent of the entity
         // children
-        std::list<Entity*>              _children;                  // list of child entities
+        ChildList                       _children;                  // list of child entities
         bool                            _childrenOwner;             // true if this parent is responsible for disposing their children
         BlendMode                       _blendMode;                 // blend mode of the entity
         // alpha settings
@@ -726,6 +737,57 @@ namespace TLFX
         bool                            _runChildren;               // When the entity is created, this is false to avoid running it's children on creation to avoid recursion
         // temps
         float                           _pixelsPerSecond;
+        // cached trig, recomputed only when the angle/direction or the trig precision changes
+        float                           _trigAngle;                 // angle _angleSin/_angleCos were computed for
+        unsigned int                    _trigAngleGeneration;       // Math::GetTrigGeneration() they were computed with
+        float                           _angleSin, _angleCos;
+        float                           _trigDirection;             // direction _directionSin/_directionCos were computed for
+        unsigned int                    _trigDirectionGeneration;   // Math::GetTrigGeneration() they were computed with
+        float                           _directionSin, _directionCos;
+
+        /**
+         * Refresh the cached sine and cosine of the angle if the angle or the trig precision changed
+         */
+        void UpdateAngleTrig()
+        {
+            unsigned int generation = Math::GetTrigGeneration();
+            if (_angle != _trigAngle || generation != _trigAngleGeneration)
+            {
+                Math::SinCos(_angle, _angleSin, _angleCos);
+                _trigAngle = _angle;
+                _trigAngleGeneration = generation;
+            }
+        }
+
+        /**
+         * Refresh the cached sine and cosine of the direction if the direction or the trig precision changed
+         */
+        void UpdateDirectionTrig()
+        {
+            unsigned int generation = Math::GetTrigGeneration();
+            if (_direction != _trigDirection || generation != _trigDirectionGeneration)
+            {
+                Math::SinCos(_direction, _directionSin, _directionCos);
+                _trigDirection = _direction;
+                _trigDirectionGeneration = generation;
+            }
+        }
+
+        /**
+         * Set the matrix to the rotation of the current angle, using the cached sine and cosine
+         */
+        void UpdateRotationMatrix();
+
+        // the steps of #Update, in order (batched updates replace #UpdateMotion and #UpdateWorldPosition with Kernels::Integrate)
+        void UpdateMotion(float currentUpdateTime);             // speed vector, position and gravity
+        void UpdateWorldMatrix();                               // matrix and angle relative to the parent
+        void UpdateWorldPosition();                             // world coords
+        void UpdateFrameAndBounds(float currentUpdateTime);     // animation frame, bounding box and radius
+
+        /**
+         * Copy the state of another entity, like the copy constructor but without the name and the children
+         */
+        void Assign(const Entity& o);
     };
 
 } // namespace TLFX
@@ -0,0 +1,314 @@
+#include "TLFXKernels.h"
+
+#if !defined(TLFX_NO_SIMD)
+#   if defined(__AVX2__)
+#       define TLFX_SIMD_AVX2
+#       include <immintrin.h>
+#   elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define TLFX_SIMD_SSE2
+#       include <emmintrin.h>
+#   endif
+#endif
+
+namespace TLFX
+{
+
+    void IntegrateBatch::Resize( int count )
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        gravity.resize(count);
+        speedVecX.resize(count);
+        speedVecY.resize(count);
+        pixelsPerSecond.resize(count);
+        speed.resize(count);
+        directionSin.resize(count);
+        directionCos.resize(count);
+        weight.resize(count);
+        relative.resize(count);
+        wx.resize(count);
+        wy.resize(count);
+        trigDirection.resize(count);
+        trigSin.resize(count);
+        trigCos.resize(count);
+        trigIndex.resize(count);
+    }
+
+    namespace
+    {
+        struct IntegrateArrays
+        {
+            float *x, *y, *z, *gravity, *speedVecX, *speedVecY, *pixelsPerSecond;
+            const float *speed, *directionSin, *directionCos, *weight, *relative;
+            float *wx, *wy;
+        };
+
+        // reference implementation, must match Entity::UpdateMotion and Entity::UpdateWorldPosition
+        void IntegrateScalar(const IntegrateArrays& a, int from, int to, float t, const Matrix2& m, float pwx, float pwy, float pz)
+        {
+            for (int i = from; i < to; ++i)
+            {
+                float x = a.x[i], y = a.y[i], z = a.z[i];
+
+                if (a.speed[i] != 0)
+                {
+                    float pps = a.speed[i] / t;
+                    a.pixelsPerSecond[i] = pps;
+                    a.speedVecX[i] = a.directionSin[i] * pps;
+                    a.speedVecY[i] = a.directionCos[i] * pps;
+                    x += a.speedVecX[i] * z;
+                    y -= a.speedVecY[i] * z;
+                }
+
+                if (a.weight[i] != 0)
+                {
+                    a.gravity[i] += a.weight[i] / t;
+                    y += (a.gravity[i] / t) * z;
+                }
+
+                a.x[i] = x;
+                a.y[i] = y;
+
+                if (a.relative[i] != 0)
+                {
+                    a.z[i] = pz;
+                    a.wx[i] = pwx + (x * m.aa + y * m.ba) * pz;
+                    a.wy[i] = pwy + (x * m.ab + y * m.bb) * pz;
+                }
+                else
+                {
+                    a.wx[i] = x;
+                    a.wy[i] = y;
+                }
+            }
+        }
+
+#if defined(TLFX_SIMD_AVX2)
+        inline __m256 Select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+
+        int IntegrateSimd(const IntegrateArrays& a, int count, float t, const Matrix2& m, float pwx, float pwy, float pz)
+        {
+            const __m256 vt = _mm256_set1_ps(t);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 aa = _mm256_set1_ps(m.aa), ab = _mm256_set1_ps(m.ab), ba = _mm256_set1_ps(m.ba), bb = _mm256_set1_ps(m.bb);
+            const __m256 vpwx = _mm256_set1_ps(pwx), vpwy = _mm256_set1_ps(pwy), vpz = _mm256_set1_ps(pz);
+
+            int i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(a.x + i);
+                __m256 y = _mm256_loadu_ps(a.y + i);
+                __m256 z = _mm256_loadu_ps(a.z + i);
+
+                // speed
+                __m256 s = _mm256_loadu_ps(a.speed + i);
+                __m256 moving = _mm256_cmp_ps(s, zero, _CMP_NEQ_UQ);
+                __m256 pps = _mm256_div_ps(s, vt);
+                __m256 svx = _mm256_mul_ps(_mm256_loadu_ps(a.directionSin + i), pps);
+                __m256 svy = _mm256_mul_ps(_mm256_loadu_ps(a.directionCos + i), pps);
+                _mm256_storeu_ps(a.pixelsPerSecond + i, Select(moving, pps, _mm256_loadu_ps(a.pixelsPerSecond + i)));
+                _mm256_storeu_ps(a.speedVecX + i, Select(moving, svx, _mm256_loadu_ps(a.speedVecX + i)));
+                _mm256_storeu_ps(a.speedVecY + i, Select(moving, svy, _mm256_loadu_ps(a.speedVecY + i)));
+                x = Select(moving, _mm256_add_ps(x, _mm256_mul_ps(svx, z)), x);
+                y = Select(moving, _mm256_sub_ps(y, _mm256_mul_ps(svy, z)), y);
+
+                // gravity
+                __m256 w = _mm256_loadu_ps(a.weight + i);
+                __m256 heavy = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+                __m256 g = _mm256_loadu_ps(a.gravity + i);
+                __m256 ng = _mm256_add_ps(g, _mm256_div_ps(w, vt));
+                _mm256_storeu_ps(a.gravity + i, Select(heavy, ng, g));
+                y = Select(heavy, _mm256_add_ps(y, _mm256_mul_ps(_mm256_div_ps(ng, vt), z)), y);
+
+                _mm256_storeu_ps(a.x + i, x);
+                _mm256_storeu_ps(a.y + i, y);
+
+                // world coords
+                __m256 rel = _mm256_cmp_ps(_mm256_loadu_ps(a.relative + i), zero, _CMP_NEQ_UQ);
+                __m256 rx = _mm256_add_ps(_mm256_mul_ps(x, aa), _mm256_mul_ps(y, ba));
+                __m256 ry = _mm256_add_ps(_mm256_mul_ps(x, ab), _mm256_mul_ps(y, bb));
+                _mm256_storeu_ps(a.z + i, Select(rel, vpz, z));
+                _mm256_storeu_ps(a.wx + i, Select(rel, _mm256_add_ps(vpwx, _mm256_mul_ps(rx, vpz)), x));
+                _mm256_storeu_ps(a.wy + i, Select(rel, _mm256_add_ps(vpwy, _mm256_mul_ps(ry, vpz)), y));
+            }
+            return i;
+        }
+#elif defined(TLFX_SIMD_SSE2)
+        inline __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+        int IntegrateSimd(const IntegrateArrays& a, int count, float t, const Matrix2& m, float pwx, float pwy, float pz)
+        {
+            const __m128 vt = _mm_set1_ps(t);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 aa = _mm_set1_ps(m.aa), ab = _mm_set1_ps(m.ab), ba = _mm_set1_ps(m.ba), bb = _mm_set1_ps(m.bb);
+            const __m128 vpwx = _mm_set1_ps(pwx), vpwy = _mm_set1_ps(pwy), vpz = _mm_set1_ps(pz);
+
+            int i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(a.x + i);
+                __m128 y = _mm_loadu_ps(a.y + i);
+                __m128 z = _mm_loadu_ps(a.z + i);
+
+                // speed
+                __m128 s = _mm_loadu_ps(a.speed + i);
+                __m128 moving = _mm_cmpneq_ps(s, zero);
+                __m128 pps = _mm_div_ps(s, vt);
+                __m128 svx = _mm_mul_ps(_mm_loadu_ps(a.directionSin + i), pps);
+                __m128 svy = _mm_mul_ps(_mm_loadu_ps(a.directionCos + i), pps);
+                _mm_storeu_ps(a.pixelsPerSecond + i, Select(moving, pps, _mm_loadu_ps(a.pixelsPerSecond + i)));
+                _mm_storeu_ps(a.speedVecX + i, Select(moving, svx, _mm_loadu_ps(a.speedVecX + i)));
+                _mm_storeu_ps(a.speedVecY + i, Select(moving, svy, _mm_loadu_ps(a.speedVecY + i)));
+                x = Select(moving, _mm_add_ps(x, _mm_mul_ps(svx, z)), x);
+                y = Select(moving, _mm_sub_ps(y, _mm_mul_ps(svy, z)), y);
+
+                // gravity
+                __m128 w = _mm_loadu_ps(a.weight + i);
+                __m128 heavy = _mm_cmpneq_ps(w, zero);
+                __m128 g = _mm_loadu_ps(a.gravity + i);
+                __m128 ng = _mm_add_ps(g, _mm_div_ps(w, vt));
+                _mm_storeu_ps(a.gravity + i, Select(heavy, ng, g));
+                y = Select(heavy, _mm_add_ps(y, _mm_mul_ps(_mm_div_ps(ng, vt), z)), y);
+
+                _mm_storeu_ps(a.x + i, x);
+                _mm_storeu_ps(a.y + i, y);
+
+                // world coords
+                __m128 rel = _mm_cmpneq_ps(_mm_loadu_ps(a.relative + i), zero);
+                __m128 rx = _mm_add_ps(_mm_mul_ps(x, aa), _mm_mul_ps(y, ba));
+                __m128 ry = _mm_add_ps(_mm_mul_ps(x, ab), _mm_mul_ps(y, bb));
+                _mm_storeu_ps(a.z + i, Select(rel, vpz, z));
+                _mm_storeu_ps(a.wx + i, Select(rel, _mm_add_ps(vpwx, _mm_mul_ps(rx, vpz)), x));
+                _mm_storeu_ps(a.wy + i, Select(rel, _mm_add_ps(vpwy, _mm_mul_ps(ry, vpz)), y));
+            }
+            return i;
+        }
+#else
+        int IntegrateSimd(const IntegrateArrays&, int, float, const Matrix2&, float, float, float)
+        {
+            return 0;
+        }
+#endif
+    }
+
+    void Kernels::SampleOverTime( const float *table, unsigned int lastIndex, float life, float frequency,
+                                  const float *ages, const float *lifetimes, float *out, int count )
+    {
+        // same operations as EmitterArray::GetOT, clamping in float is the same as clamping the truncated index
+        const float last = (float)lastIndex;
+        int i = 0;
+#if defined(TLFX_SIMD_AVX2)
+        const __m256 zero = _mm256_setzero_ps(), vlife = _mm256_set1_ps(life), vfreq = _mm256_set1_ps(frequency), vlast = _mm256_set1_ps(last);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 lt = _mm256_loadu_ps(lifetimes + i);
+            __m256 frame = _mm256_div_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_loadu_ps(ages + i), lt), vlife), vfreq);
+            frame = _mm256_and_ps(_mm256_cmp_ps(lt, zero, _CMP_GT_OQ), frame);
+            frame = _mm256_max_ps(_mm256_min_ps(frame, vlast), zero);
+            _mm256_storeu_ps(out + i, _mm256_i32gather_ps(table, _mm256_cvttps_epi32(frame), 4));
+        }
+#elif defined(TLFX_SIMD_SSE2)
+        const __m128 zero = _mm_setzero_ps(), vlife = _mm_set1_ps(life), vfreq = _mm_set1_ps(frequency), vlast = _mm_set1_ps(last);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 lt = _mm_loadu_ps(lifetimes + i);
+            __m128 frame = _mm_div_ps(_mm_mul_ps(_mm_div_ps(_mm_loadu_ps(ages + i), lt), vlife), vfreq);
+            frame = _mm_and_ps(_mm_cmpgt_ps(lt, zero), frame);
+            frame = _mm_max_ps(_mm_min_ps(frame, vlast), zero);
+            int index[4];
+            _mm_storeu_si128((__m128i*)index, _mm_cvttps_epi32(frame));
+            out[i    ] = table[index[0]];
+            out[i + 1] = table[index[1]];
+            out[i + 2] = table[index[2]];
+            out[i + 3] = table[index[3]];
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float frame = 0;
+            if (lifetimes[i] > 0)
+                frame = ages[i] / lifetimes[i] * life / frequency;
+            if (frame > last)
+                frame = last;
+            out[i] = table[frame > 0 ? (unsigned int)frame : 0];
+        }
+    }
+
+    void Kernels::OverTimeIndex( unsigned int lastIndex, float life, float frequency,
+                                 const float *ages, const float *lifetimes, int *out, int count )
+    {
+        // same as SampleOverTime without the fetch
+        const float last = (float)lastIndex;
+        int i = 0;
+#if defined(TLFX_SIMD_AVX2)
+        const __m256 zero = _mm256_setzero_ps(), vlife = _mm256_set1_ps(life), vfreq = _mm256_set1_ps(frequency), vlast = _mm256_set1_ps(last);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 lt = _mm256_loadu_ps(lifetimes + i);
+            __m256 frame = _mm256_div_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_loadu_ps(ages + i), lt), vlife), vfreq);
+            frame = _mm256_and_ps(_mm256_cmp_ps(lt, zero, _CMP_GT_OQ), frame);
+            frame = _mm256_max_ps(_mm256_min_ps(frame, vlast), zero);
+            _mm256_storeu_si256((__m256i*)(out + i), _mm256_cvttps_epi32(frame));
+        }
+#elif defined(TLFX_SIMD_SSE2)
+        const __m128 zero = _mm_setzero_ps(), vlife = _mm_set1_ps(life), vfreq = _mm_set1_ps(frequency), vlast = _mm_set1_ps(last);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 lt = _mm_loadu_ps(lifetimes + i);
+            __m128 frame = _mm_div_ps(_mm_mul_ps(_mm_div_ps(_mm_loadu_ps(ages + i), lt), vlife), vfreq);
+            frame = _mm_and_ps(_mm_cmpgt_ps(lt, zero), frame);
+            frame = _mm_max_ps(_mm_min_ps(frame, vlast), zero);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_cvttps_epi32(frame));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float frame = 0;
+            if (lifetimes[i] > 0)
+                frame = ages[i] / lifetimes[i] * life / frequency;
+            if (frame > last)
+                frame = last;
+            out[i] = frame > 0 ? (int)frame : 0;
+        }
+    }
+
+    void Kernels::Integrate( IntegrateBatch& batch, int begin, int end, float updateTime,
+                             const Matrix2& parentMatrix, float parentWX, float parentWY, float parentZ )
+    {
+        int count = end - begin;
+        if (count <= 0)
+            return;
+
+        IntegrateArrays a;
+        a.x = &batch.x[begin];
+        a.y = &batch.y[begin];
+        a.z = &batch.z[begin];
+        a.gravity = &batch.gravity[begin];
+        a.speedVecX = &batch.speedVecX[begin];
+        a.speedVecY = &batch.speedVecY[begin];
+        a.pixelsPerSecond = &batch.pixelsPerSecond[begin];
+        a.speed = &batch.speed[begin];
+        a.directionSin = &batch.directionSin[begin];
+        a.directionCos = &batch.directionCos[begin];
+        a.weight = &batch.weight[begin];
+        a.relative = &batch.relative[begin];
+        a.wx = &batch.wx[begin];
+        a.wy = &batch.wy[begin];
+
+        int done = IntegrateSimd(a, count, updateTime, parentMatrix, parentWX, parentWY, parentZ);
+        IntegrateScalar(a, done, count, updateTime, parentMatrix, parentWX, parentWY, parentZ);
+    }
+
+    const char* Kernels::GetInstructionSet()
+    {
+#if defined(TLFX_SIMD_AVX2)
+        return "avx2";
+#elif defined(TLFX_SIMD_SSE2)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+} // namespace TLFX
@@ -0,0 +1,95 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_KERNELS_H
+#define _TLFX_KERNELS_H
+
+#include "TLFXMatrix2.h"
+
+#include <vector>
+
+namespace TLFX
+{
+
+    /**
+     * Structure-of-arrays scratch buffer for #Kernels::Integrate
+     * <p>An emitter gathers the motion state of its particles into the arrays, runs the kernel over all of them at once and scatters
+     * the results back. Index i of every array belongs to the same particle.</p>
+     */
+    class IntegrateBatch
+    {
+    public:
+        /**
+         * Make room for count particles, keeps the capacity so that steady state updates don't allocate
+         */
+        void Resize(int count);
+
+        int Size() const { return (int)x.size(); }
+
+        // in/out
+        std::vector<float>  x, y;                   // local coords
+        std::vector<float>  z;                      // zoom, replaced by the parent's zoom for relative particles
+        std::vector<float>  gravity;
+        std::vector<float>  speedVecX, speedVecY;   // only written for moving particles
+        std::vector<float>  pixelsPerSecond;        // only written for moving particles
+        // in
+        std::vector<float>  speed;                  // 0 if the particle doesn't move (or doesn't update its speed)
+        std::vector<float>  directionSin, directionCos;
+        std::vector<float>  weight;
+        std::vector<float>  relative;               // 1 if the particle is relative to its parent, 0 otherwise
+        // out
+        std::vector<float>  wx, wy;                 // world coords
+
+        // scratch for the emitter: the directions whose sine and cosine have to be recomputed, packed from the start of each chunk
+        std::vector<float>  trigDirection, trigSin, trigCos;
+        std::vector<int>    trigIndex;
+    };
+
+    /**
+     * Batched versions of the per-entity update steps
+     * <p>The kernels use AVX2 or SSE2 when the compiler targets them (define TLFX_NO_SIMD to force the scalar code) and process the
+     * remaining elements with the scalar code.</p>
+     */
+    class Kernels
+    {
+    public:
+        /**
+         * Integrate the motion of the particles [begin, end) of the batch, all sharing the same parent
+         * This does what Entity::Update does before updating the matrix: speed vector from the direction, position, gravity and world
+         * coordinates. Only plain multiplications, additions and divisions are used, in the same order as Entity::Update, so the results
+         * are identical to the scalar path unless the compiler contracts the scalar code into fused multiply-adds (eg. with -mfma), in which
+         * case they can differ by 1 ulp per operation.
+         * @param updateTime The current update time (EffectsLibrary::GetCurrentUpdateTime)
+         * @param parentMatrix, parentWX, parentWY, parentZ The world transform of the parent, used for relative particles
+         */
+        static void Integrate(IntegrateBatch& batch, int begin, int end, float updateTime,
+                              const Matrix2& parentMatrix, float parentWX, float parentWY, float parentZ);
+
+        /**
+         * Sample a compiled over-time table for count particles
+         * For each particle this does what EmitterArray::GetOT does on a compiled array: the age is normalized by the lifetime into a frame
+         * of the table (0 if the lifetime is 0), the frame is truncated and clamped to the last entry, and the entry is fetched. The
+         * normalization and the clamp run on whole vectors, the fetch uses a gather with AVX2.
+         * @param table, lastIndex The compiled values and the index of the last one
+         * @param life, frequency The life the table was compiled for and the over-time lookup frequency
+         */
+        static void SampleOverTime(const float *table, unsigned int lastIndex, float life, float frequency,
+                                   const float *ages, const float *lifetimes, float *out, int count);
+
+        /**
+         * Compute the over-time table index of count particles
+         * This is the index #SampleOverTime fetches, for tables holding several values per index (see EmitterTable).
+         */
+        static void OverTimeIndex(unsigned int lastIndex, float life, float frequency,
+                                  const float *ages, const float *lifetimes, int *out, int count);
+
+        /**
+         * Get the name of the instruction set the kernels were compiled for: "avx2", "sse2" or "scalar"
+         */
+        static const char* GetInstructionSet();
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_KERNELS_H
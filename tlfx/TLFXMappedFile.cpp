@@ -0,0 +1,129 @@
+#include "TLFXMappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TLFX
+{
+
+    MappedFile::MappedFile()
+        : _data(NULL)
+        , _size(0)
+        , _buffer(NULL)
+        , _mapping(NULL)
+    {
+        _error[0] = 0;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open( const char *filename, size_t alignment /*= 1*/ )
+    {
+        _error[0] = 0;
+        Close();
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            LARGE_INTEGER size;
+            HANDLE mapping = NULL;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (unsigned long long)size.QuadPart <= SIZE_MAX)
+                mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            CloseHandle(file);
+            if (mapping)
+            {
+                const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (data)
+                {
+                    _data = (const char*)data;
+                    _size = (size_t)size.QuadPart;
+                    _mapping = mapping;
+                    return true;
+                }
+                CloseHandle(mapping);
+            }
+        }
+#elif defined(__unix__) || defined(__APPLE__)
+        int fd = open(filename, O_RDONLY);
+        if (fd >= 0)
+        {
+            struct stat st;
+            void *data = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && st.st_size > 0 && (unsigned long long)st.st_size <= SIZE_MAX)
+                data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data != MAP_FAILED)
+            {
+                _data = (const char*)data;
+                _size = (size_t)st.st_size;
+                _mapping = data;
+                return true;
+            }
+        }
+#endif
+
+        // no mapping, read the file in a buffer aligned like a mapping would be
+        FILE *f = fopen(filename, "rb");
+        if (!f)
+        {
+            snprintf(_error, sizeof(_error), "Cannot open %s", filename);
+            return false;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (alignment < 1)
+            alignment = 1;
+        if (size >= 0 && (_buffer = malloc((size_t)size + alignment)) != NULL)
+        {
+            char *data = (char*)_buffer + (alignment - (size_t)_buffer % alignment) % alignment;
+            if (fread(data, 1, (size_t)size, f) == (size_t)size)
+            {
+                _data = data;
+                _size = (size_t)size;
+            }
+        }
+        fclose(f);
+        if (!_data)
+        {
+            snprintf(_error, sizeof(_error), "Cannot read %s", filename);
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+#if defined(_WIN32)
+        if (_mapping)
+        {
+            UnmapViewOfFile(_data);
+            CloseHandle((HANDLE)_mapping);
+        }
+#elif defined(__unix__) || defined(__APPLE__)
+        if (_mapping)
+            munmap(_mapping, _size);
+#endif
+        free(_buffer);
+        _buffer = NULL;
+        _mapping = NULL;
+        _data = NULL;
+        _size = 0;
+    }
+
+} // namespace TLFX
@@ -0,0 +1,51 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_MAPPEDFILE_H
+#define _TLFX_MAPPEDFILE_H
+
+#include <cstddef>
+
+namespace TLFX
+{
+
+    /**
+     * A file mapped read only in memory
+     * <p>Uses mmap or MapViewOfFile, or reads the whole file in a buffer where the file can't be mapped. The data stays valid until #Close.</p>
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        /**
+         * Map a file
+         * @param alignment The alignment of the data when the file has to be read in a buffer, mappings are page aligned
+         */
+        bool Open(const char *filename, size_t alignment = 1);
+        void Close();
+
+        const char* GetData() const { return _data; }
+        size_t      GetSize() const { return _size; }
+        bool        IsOpen() const { return _data != NULL; }
+        bool        IsMapped() const { return _mapping != NULL; }
+
+        const char* GetLastError() const { return _error; }
+
+    protected:
+        const char *_data;
+        size_t      _size;
+        void       *_buffer;                // the file read in memory when it can't be mapped
+        void       *_mapping;               // platform handle of the mapping, if any
+
+        char _error[128];
+
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_MAPPEDFILE_H
@@ -0,0 +1,40 @@
+#include "TLFXMath.h"
+
+namespace TLFX
+{
+
+    Math::TrigPrecision Math::_trigPrecision = Math::TrigPrecise;
+    unsigned int Math::_trigGeneration = 0;
+
+    void Math::SetTrigPrecision( TrigPrecision precision )
+    {
+        if (precision != _trigPrecision)
+        {
+            _trigPrecision = precision;
+            ++_trigGeneration;
+        }
+    }
+
+    Math::TrigPrecision Math::GetTrigPrecision()
+    {
+        return _trigPrecision;
+    }
+
+    void Math::SinCosArray( const float *degrees, float *s, float *c, int count )
+    {
+        if (_trigPrecision == TrigFast)
+        {
+            for (int i = 0; i < count; ++i)
+                FastSinCos(degrees[i], s[i], c[i]);
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                s[i] = sinf(degrees[i] / 180.0f * (float)M_PI);
+                c[i] = cosf(degrees[i] / 180.0f * (float)M_PI);
+            }
+        }
+    }
+
+} // namespace TLFX
@@ -0,0 +1,104 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_MATH_H
+#define _TLFX_MATH_H
+
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace TLFX
+{
+
+    /**
+     * Math helpers shared by the entities
+     * <p>Angles in TimelineFX are in degrees. #SinCos returns the sine and cosine of such an angle, either with the standard library
+     * (#TrigPrecise, the default) or with a polynomial approximation (#TrigFast) that computes both values with a single range reduction.
+     * The fast path is accurate to about 1e-7, which is invisible on screen but not bit-identical to sinf/cosf.</p>
+     */
+    class Math
+    {
+    public:
+        enum TrigPrecision
+        {
+            TrigPrecise,                    // sinf/cosf
+            TrigFast                        // polynomial approximation
+        };
+
+        /**
+         * Select how #SinCos computes its values, for all entities
+         */
+        static void SetTrigPrecision(TrigPrecision precision);
+        static TrigPrecision GetTrigPrecision();
+
+        /**
+         * Get a number that changes whenever #SetTrigPrecision changes the precision
+         * Values cached from #SinCos are only valid while it stays the same.
+         */
+        static unsigned int GetTrigGeneration();
+
+        /**
+         * Get the sine and cosine of an angle in degrees using the current trig precision
+         */
+        static void SinCos(float degrees, float& s, float& c);
+
+        /**
+         * Get the sine and cosine of an angle in degrees using the polynomial approximation
+         */
+        static void FastSinCos(float degrees, float& s, float& c);
+
+        /**
+         * Get the sine and cosine of count angles in degrees using the current trig precision
+         * Use this to convert many directions to vectors at once, the loop is simple enough for the compiler to vectorize it in #TrigFast mode.
+         * The batched particle update calls it for the directions that changed since the last tick.
+         */
+        static void SinCosArray(const float *degrees, float *s, float *c, int count);
+
+    protected:
+        static TrigPrecision _trigPrecision;
+        static unsigned int  _trigGeneration;
+    };
+
+    inline unsigned int Math::GetTrigGeneration()
+    {
+        return _trigGeneration;
+    }
+
+    inline void Math::FastSinCos( float degrees, float& s, float& c )
+    {
+        // reduce to [-45, 45] degrees and a quadrant, then use the minimax polynomials from Cephes sinf/cosf
+        // (written without branches so that loops over it can be vectorized)
+        float t = degrees / 90.0f;
+        int q = (int)(t + (t >= 0 ? 0.5f : -0.5f));
+        float x = (degrees - (float)q * 90.0f) * (float)(M_PI / 180.0);
+        float z = x * x;
+
+        float sr = x + x * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+        float cr = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+
+        float ss = (q & 1) ? cr : sr;
+        float cc = (q & 1) ? sr : cr;
+        s = (q & 2) ? -ss : ss;
+        c = ((q + 1) & 2) ? -cc : cc;
+    }
+
+    inline void Math::SinCos( float degrees, float& s, float& c )
+    {
+        if (_trigPrecision == TrigFast)
+        {
+            FastSinCos(degrees, s, c);
+        }
+        else
+        {
+            s = sinf(degrees / 180.0f * (float)M_PI);
+            c = cosf(degrees / 180.0f * (float)M_PI);
+        }
+    }
+
+} // namespace TLFX
+
+#endif // _TLFX_MATH_H
@@ -0,0 +1,226 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_NODEALLOCATOR_H
+#define _TLFX_NODEALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <thread>
+
+namespace TLFX
+{
+
+    /**
+     * Free lists of the blocks of one size
+     * <p>Each thread keeps the blocks it releases on its own list, without locking, up to #localLimit blocks. Past that, a batch goes to a
+     * list shared by all the threads, and a thread whose list is empty takes a batch from there before it turns to the heap. So a thread
+     * that mostly releases nodes taken by other threads doesn't hoard them, and the blocks stay reusable by the threads that allocate.</p>
+     * <p>When a thread ends its blocks go to the shared list. The shared list is never destroyed, so blocks released while the objects with
+     * static storage are destroyed, after the thread local objects of the main thread, still have somewhere to go. The blocks are only
+     * given back to the heap when the process ends.</p>
+     */
+    template <size_t Size>
+    class NodeFreeList
+    {
+    public:
+        static const size_t localLimit = 256;
+        static const size_t batchSize = localLimit / 2;
+
+        static void* Pop()
+        {
+            Local& local = GetLocal();
+            if (!local.head)
+            {
+                if (local.released)
+                    return PopShared();
+                TakeShared(local);
+            }
+            Node *n = local.head;
+            if (n)
+            {
+                local.head = n->next;
+                --local.count;
+            }
+            return n;
+        }
+
+        static void Push(void *p)
+        {
+            Node *n = static_cast<Node*>(p);
+            Local& local = GetLocal();
+            if (local.released)
+            {
+                GiveShared(n, n);
+                return;
+            }
+            if (!local.registered)
+            {
+                static thread_local Releaser releaser;
+                local.registered = true;
+            }
+
+            n->next = local.head;
+            local.head = n;
+            if (++local.count > localLimit)
+            {
+                // hand the most recently released blocks over, the rest stays local
+                Node *first = local.head, *last = first;
+                for (size_t i = 1; i < batchSize; ++i)
+                    last = last->next;
+                local.head = last->next;
+                local.count -= batchSize;
+                GiveShared(first, last);
+            }
+        }
+
+    protected:
+        struct Node
+        {
+            Node *next;
+        };
+
+        // both trivially destructible so that they are still usable while the objects with static storage are destroyed
+        struct Local
+        {
+            Node *head;
+            size_t count;
+            bool registered;        // the Releaser of the thread is constructed
+            bool released;          // and it gave the blocks to the shared list
+        };
+
+        struct Shared
+        {
+            std::atomic_flag lock;
+            Node *head;
+        };
+
+        struct Releaser
+        {
+            ~Releaser()
+            {
+                Local& local = GetLocal();
+                if (local.head)
+                {
+                    Node *last = local.head;
+                    while (last->next)
+                        last = last->next;
+                    GiveShared(local.head, last);
+                }
+                local.head = NULL;
+                local.count = 0;
+                local.released = true;
+            }
+        };
+
+        static Local& GetLocal()
+        {
+            static thread_local Local local = { NULL, 0, false, false };
+            return local;
+        }
+
+        static Shared& GetShared()
+        {
+            static Shared shared = { ATOMIC_FLAG_INIT, NULL };
+            return shared;
+        }
+
+        static void Lock(Shared& shared)
+        {
+            while (shared.lock.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        static void Unlock(Shared& shared)
+        {
+            shared.lock.clear(std::memory_order_release);
+        }
+
+        // the blocks first to last, linked through next
+        static void GiveShared(Node *first, Node *last)
+        {
+            Shared& shared = GetShared();
+            Lock(shared);
+            last->next = shared.head;
+            shared.head = first;
+            Unlock(shared);
+        }
+
+        static void TakeShared(Local& local)
+        {
+            Shared& shared = GetShared();
+            Lock(shared);
+            Node *first = shared.head;
+            size_t count = 0;
+            if (first)
+            {
+                Node *last = first;
+                for (count = 1; count < batchSize && last->next; ++count)
+                    last = last->next;
+                shared.head = last->next;
+                last->next = NULL;
+            }
+            Unlock(shared);
+            local.head = first;
+            local.count = count;
+        }
+
+        static void* PopShared()
+        {
+            Shared& shared = GetShared();
+            Lock(shared);
+            Node *n = shared.head;
+            if (n)
+                shared.head = n->next;
+            Unlock(shared);
+            return n;
+        }
+    };
+
+    /**
+     * Allocator for the nodes of the lists and sets of entities
+     * <p>The nodes go to a free list when they are released instead of back to the heap, so a list that has already been as long stops
+     * allocating: the children of the emitters while particles come and go, the effects of the particle manager while effects are
+     * spawned. See NodeFreeList for how the blocks move between threads. Arrays use the heap.</p>
+     */
+    template <typename T>
+    class NodeAllocator
+    {
+    public:
+        typedef T value_type;
+
+        NodeAllocator() {}
+        template <typename U> NodeAllocator(const NodeAllocator<U>&) {}
+
+        T* allocate(size_t n)
+        {
+            if (n == 1)
+            {
+                if (void *p = NodeFreeList<BlockSize>::Pop())
+                    return static_cast<T*>(p);
+                return static_cast<T*>(::operator new(BlockSize));
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, size_t n)
+        {
+            if (n == 1)
+                NodeFreeList<BlockSize>::Push(p);
+            else
+                ::operator delete(p);
+        }
+
+        template <typename U> bool operator==(const NodeAllocator<U>&) const { return true; }
+        template <typename U> bool operator!=(const NodeAllocator<U>&) const { return false; }
+
+    protected:
+        // the free list links live in the released blocks
+        static const size_t BlockSize = sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_NODEALLOCATOR_H
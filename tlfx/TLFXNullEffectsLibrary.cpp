@@ -0,0 +1,51 @@
+#include "TLFXNullEffectsLibrary.h"
+#include "TLFXPugiXMLLoader.h"
+
+namespace TLFX
+{
+
+    bool NullImage::Load()
+    {
+        return true;
+    }
+
+    NullEffectsLibrary::NullEffectsLibrary( const char *library /*= NULL*/ )
+        : _archive(NULL)
+    {
+        if (library)
+        {
+            _archive = new ZipArchive();
+            _archive->Open(library);        // failures are reported by Load
+        }
+    }
+
+    NullEffectsLibrary::~NullEffectsLibrary()
+    {
+        // the lazy loaders read from the archive
+        ClearAll();
+        delete _archive;
+    }
+
+    XMLLoader* NullEffectsLibrary::CreateLoader() const
+    {
+        return new PugiXMLLoader(0, _archive);
+    }
+
+    AnimImage* NullEffectsLibrary::CreateImage() const
+    {
+        return new NullImage();
+    }
+
+    NullParticleManager::NullParticleManager( int particles /*= particleLimit*/, int layers /*= 1*/ )
+        : ParticleManager(particles, layers)
+        , _spritesDrawn(0)
+    {
+
+    }
+
+    void NullParticleManager::DrawSprite( Particle*, AnimImage*, float, float, float, float, float, float, float, float, unsigned char, unsigned char, unsigned char, float, bool )
+    {
+        ++_spritesDrawn;
+    }
+
+} // namespace TLFX
@@ -0,0 +1,73 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+/*
+ * No rendering at all
+ * PugiXML for parsing data
+ */
+
+#ifndef _TLFX_NULLEFFECTSLIBRARY_H
+#define _TLFX_NULLEFFECTSLIBRARY_H
+
+#include "TLFXEffectsLibrary.h"
+#include "TLFXParticleManager.h"
+#include "TLFXAnimImage.h"
+#include "TLFXZipArchive.h"
+
+namespace TLFX
+{
+
+    /**
+     * Image that loads no pixels
+     * <p>The size, frame count and radius come from the library description like for the other backends, so the simulation behaves the same.</p>
+     */
+    class NullImage : public AnimImage
+    {
+    public:
+        virtual bool Load();
+    };
+
+    /**
+     * Headless effects library, for running the simulation without a renderer (benchmarks, CI, servers baking effects)
+     */
+    class NullEffectsLibrary : public EffectsLibrary
+    {
+    public:
+        /**
+         * @param library The effects library (.eff zip archive) the description file is read from, or NULL to read it from disk
+         */
+        NullEffectsLibrary(const char *library = NULL);
+        virtual ~NullEffectsLibrary();
+
+        virtual XMLLoader* CreateLoader() const;
+        virtual AnimImage* CreateImage() const;
+
+    protected:
+        ZipArchive *_archive;               // opened once for all the loads, NULL without library
+    };
+
+    /**
+     * Headless particle manager
+     * <p>Updates the effects like any other particle manager but draws nothing, it only counts the sprites it would have drawn.</p>
+     */
+    class NullParticleManager : public ParticleManager
+    {
+    public:
+        NullParticleManager(int particles = ParticleManager::particleLimit, int layers = 1);
+
+        /**
+         * Get the number of sprites DrawParticles submitted since the last #ResetSpritesDrawn
+         */
+        long GetSpritesDrawn() const { return _spritesDrawn; }
+        void ResetSpritesDrawn() { _spritesDrawn = 0; }
+
+    protected:
+        virtual void DrawSprite(Particle *p, AnimImage* sprite, float px, float py, float frame, float x, float y, float rotation, float scaleX, float scaleY, unsigned char r, unsigned char g, unsigned char b, float a, bool additive);
+
+        long _spritesDrawn;
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_NULLEFFECTSLIBRARY_H
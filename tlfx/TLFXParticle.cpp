@@ -30,12 +30,21 @@ namespace TLFX
         , _layer(0)
         , _groupParticles(false)
         , _effectLayer(0)
-		// can't initialize _listIter without knowing what list this particle will be put into
+        , _listPrev(NULL)
+        , _listNext(NULL)
+        , _list(NULL)
     {
 
     }
 
     bool Particle::Update()
+    {
+        BeginUpdate();
+        base::Update();
+        return EndUpdate();
+    }
+
+    void Particle::BeginUpdate()
     {
         TLFXLOG(PARTICLES, ("particle #%p update", this));
 
@@ -57,9 +66,10 @@ namespace TLFX
         {
             _age = _particleManager->GetCurrentTime() - _dob;
         }
+    }
 
-        base::Update();
-
+    bool Particle::EndUpdate( bool control /*= true*/ )
+    {
         if (_age > _lifeTime || _dead == 2) // if dead=2 then that means its reached the end of the line (in kill mode) for line traversal effects
         {
             _dead = 1;
@@ -81,7 +91,9 @@ namespace TLFX
             return true;
         }
 
-        _emitter->ControlParticle(this);
+        if (control)
+            _emitter->ControlParticle(this);
+
         return true;
     }
 
@@ -109,7 +121,7 @@ namespace TLFX
         _gravity = 0;
         _weight = 0;
         _emitter = NULL;
-		// let _listIter stay an invalid iterator
+        // the list links are owned by whoever manages the particle (see ParticleList)
     }
 
     void Particle::Destroy(bool releaseChildren)
@@ -186,6 +198,18 @@ namespace TLFX
         _emitter = e;
     }
 
+    const char * Particle::GetName() const
+    {
+        return _emitter ? _emitter->GetName() : "";
+    }
+
+    std::string Particle::GetDebugName() const
+    {
+        std::string name = "(particle)";
+        name.append(GetName());
+        return name;
+    }
+
     void Particle::SetParticleManager( ParticleManager *pm )
     {
         _particleManager = pm;
@@ -285,15 +309,49 @@ namespace TLFX
     {
         return _weightVariation;
     }
-	
-	void Particle::SetIter(ParticleList::iterator iter)
-	{
-		_listIter = iter;
-	}
-	
-	ParticleList::iterator Particle::GetIter() const
-	{
-		return _listIter;
-	}
+
+    const ParticleList* Particle::GetList() const
+    {
+        return _list;
+    }
+
+    ParticleList::ParticleList( const ParticleList& o )
+        : _head(NULL), _tail(NULL), _size(0)
+    {
+        assert(o.empty());
+        (void)o;
+    }
+
+    ParticleList& ParticleList::operator=( const ParticleList& o )
+    {
+        assert(empty() && o.empty());
+        (void)o;
+        return *this;
+    }
+
+    void ParticleList::clear()
+    {
+        while (_head)
+            erase(_head);
+    }
+
+    void ParticleList::splice( ParticleList& o )
+    {
+        if (o.empty())
+            return;
+
+        for (Particle *p = o._head; p; p = p->_listNext)
+            p->_list = this;
+        o._head->_listPrev = _tail;
+        if (_tail)
+            _tail->_listNext = o._head;
+        else
+            _head = o._head;
+        _tail = o._tail;
+        _size += o._size;
+
+        o._head = o._tail = NULL;
+        o._size = 0;
+    }
 
 } // namespace TLFX
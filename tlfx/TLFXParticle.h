@@ -7,7 +7,8 @@
 
 #include "TLFXEntity.h"
 
-#include <list>
+#include <string>
+#include <cassert>
 
 namespace TLFX
 {
@@ -15,8 +16,60 @@ namespace TLFX
     class Emitter;
     class ParticleManager;
 	class Particle;
-	
-	typedef std::list<Particle*> ParticleList;
+
+    /**
+     * Intrusive list of particles
+     * <p>The links are stored in the particles themselves, so adding and removing a particle never allocates and removing is O(1) without
+     * having to keep an iterator around. A particle can be in one list at a time.</p>
+     * <p>Lists are not meant to be copied: copying is only allowed for empty lists (so they can be stored in a std::vector) and gives an empty list.</p>
+     */
+    class ParticleList
+    {
+    public:
+        class iterator
+        {
+        public:
+            iterator(Particle *p = NULL) : _p(p) {}
+            Particle* operator*() const { return _p; }
+            iterator& operator++();
+            iterator  operator++(int);
+            bool operator==(const iterator& o) const { return _p == o._p; }
+            bool operator!=(const iterator& o) const { return _p != o._p; }
+        private:
+            Particle *_p;
+        };
+        typedef iterator const_iterator;
+
+        ParticleList() : _head(NULL), _tail(NULL), _size(0) {}
+        ParticleList(const ParticleList& o);
+        ParticleList& operator=(const ParticleList& o);
+        ~ParticleList() { clear(); }
+
+        iterator begin() const { return iterator(_head); }
+        iterator end() const { return iterator(); }
+        bool empty() const { return _head == NULL; }
+        size_t size() const { return _size; }
+        Particle* front() const { return _head; }
+
+        void push_back(Particle *p);
+        void erase(Particle *p);
+        bool contains(const Particle *p) const;
+
+        /**
+         * Move all the particles of another list to the end of this one, in order
+         */
+        void splice(ParticleList& o);
+
+        /**
+         * Unlink all particles, the particles themselves are untouched
+         */
+        void clear();
+
+    private:
+        Particle *_head;
+        Particle *_tail;
+        size_t    _size;
+    };
 
     /**
      * Particle Type - extends tlEntity
@@ -28,6 +81,7 @@ namespace TLFX
         typedef Entity base;
     public:
         friend class Emitter;
+        friend class ParticleList;
 
         Particle();
 
@@ -37,6 +91,16 @@ namespace TLFX
          */
         bool Update();
 
+        /**
+         * The steps of #Update around Entity::Update
+         * #BeginUpdate captures the old state and ages the particle, #EndUpdate releases the particle if it died or lets the emitter control it.
+         * Emitter::UpdateParticles uses them to update all its particles in a batch.
+         * @param control Set to false if the caller controls the particle itself (see Emitter::ControlParticles); only allowed if the particle has no children
+         * @return #EndUpdate returns false if the particle was released and should be removed from its emitter
+         */
+        void BeginUpdate();
+        bool EndUpdate(bool control = true);
+
         /**
          * Resets the particle so it's ready to be recycled by the particle manager
          */
@@ -71,6 +135,20 @@ namespace TLFX
         void SetEmitter(Emitter *e);
         Emitter* GetEmitter() const;
 
+        /**
+         * Get the name of the particle
+         * Particles don't store a name of their own, this returns the name of the emitter that spawned them (or an empty string if
+         * the particle is unused) so that spawning doesn't need to allocate.
+         * Note: particles used to be named "(particle)" followed by the emitter name, #GetDebugName still builds that string.
+         */
+        virtual const char *GetName() const;
+
+        /**
+         * Format a descriptive name for the particle, eg. "(particle)Flare"
+         * Only meant for logging and debugging, the string is built on every call.
+         */
+        std::string GetDebugName() const;
+
         void SetParticleManager(ParticleManager *pm);
 
         void SetReleaseSingleParticles(bool value);
@@ -99,9 +177,11 @@ namespace TLFX
 
         void SetWeightVariation(float weightVar);
         float GetWeightVariation() const;
-		
-		void SetIter(ParticleList::iterator iter);
-		ParticleList::iterator GetIter() const;
+
+        /**
+         * Get the particle list this particle is currently linked into, or NULL
+         */
+        const ParticleList* GetList() const;
 
     protected:
         Emitter*                    _emitter;                       // emitter it belongs to
@@ -127,10 +207,60 @@ namespace TLFX
         int                         _layer;                         // layer the particle belongs to
         bool                        _groupParticles;                // whether the particle is added the PM pool or kept in the emitter's pool
         int                         _effectLayer;
-		
-		ParticleList::iterator      _listIter;                      // for quick deletes from ParticleList
+
+        Particle*                   _listPrev;                      // intrusive links for ParticleList
+        Particle*                   _listNext;
+        ParticleList*               _list;                          // list the particle is linked into
     };
 
+    inline ParticleList::iterator& ParticleList::iterator::operator++()
+    {
+        _p = _p->_listNext;
+        return *this;
+    }
+
+    inline ParticleList::iterator ParticleList::iterator::operator++(int)
+    {
+        iterator old(*this);
+        _p = _p->_listNext;
+        return old;
+    }
+
+    inline bool ParticleList::contains( const Particle *p ) const
+    {
+        return p->_list == this;
+    }
+
+    inline void ParticleList::push_back( Particle *p )
+    {
+        assert(p->_list == NULL);
+        p->_list = this;
+        p->_listPrev = _tail;
+        p->_listNext = NULL;
+        if (_tail)
+            _tail->_listNext = p;
+        else
+            _head = p;
+        _tail = p;
+        ++_size;
+    }
+
+    inline void ParticleList::erase( Particle *p )
+    {
+        assert(p->_list == this);
+        if (p->_listPrev)
+            p->_listPrev->_listNext = p->_listNext;
+        else
+            _head = p->_listNext;
+        if (p->_listNext)
+            p->_listNext->_listPrev = p->_listPrev;
+        else
+            _tail = p->_listPrev;
+        p->_listPrev = p->_listNext = NULL;
+        p->_list = NULL;
+        --_size;
+    }
+
 } // namespace TLFX
 
 #endif // _TLFX_PARTICLE_H
@@ -4,15 +4,31 @@
 #include "TLFXEmitter.h"
 #include "TLFXAnimImage.h"
 #include "TLFXEffectsLibrary.h"
+#include "TLFXTaskPool.h"
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
 
 namespace TLFX
 {
     const int   ParticleManager::particleLimit = 5000;
 	bool        ParticleManager::createParticlesAsNeeded = true;
     float       ParticleManager::_globalAmountScale = 1.0f;
+    thread_local ParticleManager::UpdateContext* ParticleManager::_updateContext = NULL;
+
+    namespace
+    {
+        // effects without a seed get one from rand() when they are added, so that instances of the same effect differ
+        void SeedEffect(Effect *e)
+        {
+            int seed = e->GetSeed();
+            while (!seed)
+                seed = rand();
+            e->SetSeed(seed);
+        }
+    }
 
     ParticleManager::ParticleManager(int particles /*= particleLimit*/, int layers /*= 1*/)
         : _originX(0)
@@ -56,11 +72,26 @@ namespace TLFX
         , _currentTick(0)
         , _idleTimeLimit(100)
 
+        , _accumulator(0)
+        , _maxCatchUpTicks(5)
+        , _fastForward(false)
+
         , _renderCount(0)
         , _currentTween(0)
 
         , _effectLayers(0)
         , _inUseCount(0)
+        , _particleLimit(particles)
+
+        , _slab(NULL)
+        , _particleBudget(particles)
+        , _poolPolicy(createParticlesAsNeeded ? PoolGrow : PoolDrop)
+        , _victimsTick(-1)
+
+        , _taskPool(NULL)
+        , _updateThreads(0)
+
+        , _library(NULL)
     {
         _inUse.resize(layers);
         _effects.resize(layers);
@@ -71,11 +102,17 @@ namespace TLFX
             _inUse[el].resize(10);
         }
 
+        ResetPoolCounters();
+
+        // all particles live in one slab so the memory used by the pool stays flat
+        _slab = new Particle[particles];
+        _unused.reserve(particles);
         for (int c = 0; c < particles; ++c)
         {
-            Particle* p = new Particle();
+            Particle* p = &_slab[c];
             p->SetOKtoRender(false);                // @todo dan ?
-            _unused.push(p);
+            p->SetUnused(true);
+            _unused.push_back(p);
         }
     }
 
@@ -83,11 +120,19 @@ namespace TLFX
     {
         ClearAll();
         ClearInUse();
+        ClearEffectPool();
         while (!_unused.empty())
         {
-            delete _unused.top();
-            _unused.pop();
+            // only particles created by PoolGrow are allocated on their own
+            Particle *p = _unused.back();
+            if (p < _slab || p >= _slab + _particleLimit)
+                delete p;
+            _unused.pop_back();
         }
+        delete[] _slab;
+        delete _taskPool;
+        for (size_t i = 0; i < _contexts.size(); ++i)
+            delete _contexts[i];
         /*
         for (auto it = _inUse.begin(); it != _inUse.end(); ++it)
         {
@@ -119,19 +164,10 @@ namespace TLFX
             TLFXLOG(PARTICLES, ("tick: %d time: %f", _currentTick, GetCurrentTime()));
             for (int el = 0; el < _effectLayers; ++el)
             {
-                // Effect
-                for (auto it =_effects[el].begin(); it != _effects[el].end(); )
-                {
-                    if (!(*it)->Update())
-                    {
-                        //RemoveEffect(*it);
-                        auto x = *it;
-                        delete x;
-                        _effects[el].erase(it++);
-                    }
-                    else
-                        ++it;
-                }
+                if (_taskPool && _poolPolicy == PoolGrow && _effects[el].size() > 1)
+                    UpdateLayerParallel(el);
+                else
+                    UpdateLayer(el);
             }
 
             _oldOriginX = _originX;
@@ -140,19 +176,219 @@ namespace TLFX
         }
     }
 
+    float ParticleManager::Update( double elapsedSeconds )
+    {
+        double tick = EffectsLibrary::GetUpdateTime();
+        if (!_paused && elapsedSeconds > 0)
+        {
+            _accumulator += elapsedSeconds * 1000.0;
+            for (int ticks = 0; _accumulator >= tick && ticks < _maxCatchUpTicks; ++ticks)
+            {
+                Update();
+                _accumulator -= tick;
+            }
+            // too far behind, drop the whole ticks left but keep the phase
+            if (_accumulator >= tick)
+                _accumulator = fmod(_accumulator, tick);
+        }
+        return (float)(_accumulator / tick);
+    }
+
+    void ParticleManager::SetMaxCatchUpTicks( int ticks )
+    {
+        _maxCatchUpTicks = ticks < 1 ? 1 : ticks;
+    }
+
+    int ParticleManager::GetMaxCatchUpTicks() const
+    {
+        return _maxCatchUpTicks;
+    }
+
+    void ParticleManager::UpdateLayer( int layer )
+    {
+        // Effect
+        for (auto it =_effects[layer].begin(); it != _effects[layer].end(); )
+        {
+            if (!(*it)->Update())
+            {
+                //RemoveEffect(*it);
+                auto x = *it;
+                x->Dispose();
+                _effects[layer].erase(it++);
+            }
+            else
+                ++it;
+        }
+    }
+
+    void ParticleManager::UpdateLayerParallel( int layer )
+    {
+        _tasks.assign(_effects[layer].begin(), _effects[layer].end());
+        int count = (int)_tasks.size();
+        while ((int)_contexts.size() < count)
+        {
+            UpdateContext *ctx = new UpdateContext();
+            ctx->owner = this;
+            ctx->inUse.resize(_effectLayers * 10);
+            ctx->unused.reserve(2 * contextChunk + 1);
+            ctx->inUseDelta = 0;
+            ctx->grown = 0;
+            ctx->grabbed = 0;
+            ctx->alive = true;
+            _contexts.push_back(ctx);
+        }
+        // a task releases at most the particles that are in the shared lists now, so it never grows its list while running
+        for (int i = 0; i < count; ++i)
+            _contexts[i]->released.reserve(_inUseCount);
+
+        _taskPool->Run(count, UpdateTask, this);
+        MergeContexts(count);
+
+        // finished effects are disposed of in the same order as the serial update would
+        int i = 0;
+        for (auto it = _effects[layer].begin(); it != _effects[layer].end(); ++i)
+        {
+            if (!_contexts[i]->alive)
+            {
+                auto x = *it;
+                x->Dispose();
+                _effects[layer].erase(it++);
+            }
+            else
+                ++it;
+        }
+        _tasks.clear();
+    }
+
+    void ParticleManager::UpdateTask( void *arg, int index )
+    {
+        ParticleManager *pm = static_cast<ParticleManager*>(arg);
+        UpdateContext *ctx = pm->_contexts[index];
+
+        UpdateContext *previous = _updateContext;
+        _updateContext = ctx;
+        ctx->alive = pm->_tasks[index]->Update();
+        _updateContext = previous;
+    }
+
+    void ParticleManager::MergeContexts( int count )
+    {
+        // unlink first: removing particles doesn't change the order of the others, so the lists end up with the survivors in their
+        // previous order followed by the particles grabbed by each task in effect order, exactly like the serial update
+        for (int i = 0; i < count; ++i)
+        {
+            UpdateContext *ctx = _contexts[i];
+            for (size_t r = 0; r < ctx->released.size(); ++r)
+            {
+                Particle *p = ctx->released[r];
+                _inUse[p->GetEffectLayer()][p->GetLayer()].erase(p);
+                _unused.push_back(p);
+            }
+            ctx->released.clear();
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            UpdateContext *ctx = _contexts[i];
+            for (size_t l = 0; l < ctx->inUse.size(); ++l)
+                _inUse[l / 10][l % 10].splice(ctx->inUse[l]);
+
+            _unused.insert(_unused.end(), ctx->unused.begin(), ctx->unused.end());
+            ctx->unused.clear();
+
+            _inUseCount += ctx->inUseDelta;
+            assert(_inUseCount >= 0);
+            _poolCounters[PoolGrow] += ctx->grown;
+            _grabCounter += ctx->grabbed;
+            ctx->inUseDelta = 0;
+            ctx->grown = 0;
+            ctx->grabbed = 0;
+        }
+    }
+
+    ParticleManager::UpdateContext* ParticleManager::GetUpdateContext() const
+    {
+        UpdateContext *ctx = _updateContext;
+        return ctx && ctx->owner == this ? ctx : NULL;
+    }
+
+    void ParticleManager::SetUpdateThreads( int threads )
+    {
+        if (threads < 0)
+            threads = 0;
+        if (threads == _updateThreads)
+            return;
+
+        delete _taskPool;
+        _taskPool = threads > 0 ? new TaskPool(threads) : NULL;
+        _updateThreads = threads;
+    }
+
+    int ParticleManager::GetUpdateThreads() const
+    {
+        return _updateThreads;
+    }
+
+    TaskPool* ParticleManager::GetTaskPool() const
+    {
+        return _taskPool;
+    }
+
     Particle* ParticleManager::GrabParticle( Effect *effect, bool pool, int layer /*= 0*/ )
     {
+        if (UpdateContext *ctx = GetUpdateContext())
+        {
+            // inside a parallel update, only PoolGrow gets here
+            if (ctx->unused.empty())
+            {
+                std::lock_guard<std::mutex> guard(_unusedLock);
+                size_t take = _unused.size() < contextChunk ? _unused.size() : contextChunk;
+                ctx->unused.insert(ctx->unused.end(), _unused.end() - take, _unused.end());
+                _unused.resize(_unused.size() - take);
+            }
+
+            Particle *p;
+            if (!ctx->unused.empty())
+            {
+                p = ctx->unused.back();
+                ctx->unused.pop_back();
+            }
+            else
+            {
+                p = new Particle();
+                ++ctx->grown;
+            }
+            p->SetUnused(false);
+            p->SetLayer(layer);
+            p->SetGroupParticles(pool);
+
+            if (pool)
+                effect->AddInUse(layer, p);
+            else
+                ctx->inUse[effect->GetEffectLayer() * 10 + layer].push_back(p);
+
+            ++ctx->inUseDelta;
+            ++ctx->grabbed;
+            return p;
+        }
+
 		Particle *p = NULL;
-        if (!_unused.empty())
+        if (!_unused.empty() && (_poolPolicy == PoolGrow || _inUseCount < _particleBudget))
         {
-            p = _unused.top();
-            _unused.pop();
+            p = _unused.back();
+            _unused.pop_back();
             p->SetUnused(false);
 		}
-		else if(createParticlesAsNeeded)
+		else if (_poolPolicy == PoolGrow)
 		{
 			p = new Particle();
+            p->SetUnused(false);
+            ++_poolCounters[PoolGrow];
 		}
+        else if (_poolPolicy != PoolDrop)
+        {
+            p = RecycleParticle();
+        }
 
 		if(p)
 		{
@@ -162,34 +398,203 @@ namespace TLFX
             if (pool)
                 effect->AddInUse(layer, p);
             else
-			{
-				auto& plist = _inUse[effect->GetEffectLayer()][layer];
-				plist.push_back(p);
-				p->SetIter(--plist.end());
-			}
+                _inUse[effect->GetEffectLayer()][layer].push_back(p);
 
             ++_inUseCount;
+            ++_grabCounter;
 
             return p;
         }
 
+        ++_poolCounters[PoolDrop];
         return NULL;
     }
 
+    Particle* ParticleManager::RecycleParticle()
+    {
+        // candidates are collected at most once per tick (unless the list had to be truncated) and consumed best first
+        if (_victimsTick != _currentTick)
+            _victims.clear();
+
+        Particle *p = NULL;
+        while (!p)
+        {
+            while (!_victims.empty())
+            {
+                Victim v = _victims.back();
+                _victims.pop_back();
+                if (!v.p->IsUnused() && v.p->GetDoB() == v.dob && v.p->GetChildren().empty())
+                {
+                    p = v.p;
+                    break;
+                }
+            }
+
+            if (!p)
+            {
+                if (_victimsTick == _currentTick)
+                    return NULL;            // all candidates of this tick are gone
+
+                CollectVictims();
+                if (_victims.empty())
+                {
+                    _victimsTick = _currentTick;
+                    return NULL;
+                }
+            }
+        }
+
+        // kill it the same way a particle dies in Particle::Update
+        Emitter *e = p->GetEmitter();
+        if (p->GetParent())
+            p->GetParent()->RemoveChild(p);
+        ReleaseParticle(p);
+        if (p->IsGroupParticles())
+            e->GetParentEffect()->RemoveInUse(p->GetLayer(), p);
+        p->Reset();
+
+        // and take it straight back from the unused stack
+        assert(!_unused.empty() && _unused.back() == p);
+        _unused.pop_back();
+        p->SetUnused(false);
+
+        ++_poolCounters[_poolPolicy];
+        return p;
+    }
+
+    void ParticleManager::CollectVictims()
+    {
+        _victims.clear();
+
+        for (int i = 0; i < _particleLimit; ++i)
+        {
+            Particle *p = &_slab[i];
+
+            // particles with sub effects attached may be being updated further up the stack, single particles would never come back
+            if (p->IsUnused() || !p->GetChildren().empty())
+                continue;
+            Emitter *e = p->GetEmitter();
+            if (!e || e->IsSingleParticle())
+                continue;
+
+            Victim v;
+            v.p = p;
+            v.dob = p->GetDoB();
+            switch (_poolPolicy)
+            {
+            case PoolRecycleLeastVisible:
+                {
+                    float size = fabsf(p->GetScaleX() * p->GetScaleY());
+                    AnimImage *sprite = p->GetAvatar();
+                    if (sprite)
+                        size *= sprite->GetWidth() * sprite->GetHeight();
+                    v.key1 = p->GetEntityAlpha() * size;
+                    v.key2 = v.dob;
+                }
+                break;
+            case PoolStealLowestLayer:
+                v.key1 = (float)p->GetEffectLayer();
+                v.key2 = v.dob;
+                break;
+            default:
+                v.key1 = v.dob;
+                v.key2 = 0;
+                break;
+            }
+            _victims.push_back(v);
+        }
+
+        // only keep the best candidates, sorted so that the best one is last
+        size_t batch = (size_t)std::max(64, _particleBudget / 8);
+        bool truncated = _victims.size() > batch;
+        if (truncated)
+        {
+            std::nth_element(_victims.begin(), _victims.begin() + batch, _victims.end());
+            _victims.resize(batch);
+        }
+        std::sort(_victims.rbegin(), _victims.rend());
+
+        _victimsTick = truncated ? -1 : _currentTick;
+    }
+
     void ParticleManager::ReleaseParticle( Particle *p )
     {
         if(p->IsUnused()) {
 #   if defined(DEBUG) || defined(DBEBUG_MEM)
             TLFXLOG(PARTICLES, ("Double release of particle %p", p));
 #   endif
+        } else if (UpdateContext *ctx = GetUpdateContext()) {
+            p->SetUnused(true);
+            --ctx->inUseDelta;
+            if (!p->IsGroupParticles()) {
+                ParticleList& grabbed = ctx->inUse[p->GetEffectLayer() * 10 + p->GetLayer()];
+                if (p->GetList() != &grabbed) {
+                    ctx->released.push_back(p);     // the shared lists are unlinked when the contexts are merged
+                    return;
+                }
+                grabbed.erase(p);
+            }
+            ctx->unused.push_back(p);
+            if (ctx->unused.size() > 2 * contextChunk)
+            {
+                // a task that mostly releases gives its surplus back, so the cache doesn't grow and the other tasks can use them
+                std::lock_guard<std::mutex> guard(_unusedLock);
+                _unused.insert(_unused.end(), ctx->unused.end() - contextChunk, ctx->unused.end());
+                ctx->unused.resize(ctx->unused.size() - contextChunk);
+            }
         } else {
             p->SetUnused(true);
             --_inUseCount; assert(_inUseCount>=0);
-            _unused.push(p);
+            _unused.push_back(p);
             if (!p->IsGroupParticles())
+                _inUse[p->GetEffectLayer()][p->GetLayer()].erase(p);
+        }
+    }
+
+    Effect* ParticleManager::GrabEffect( const Effect& effect )
+    {
+        Effect *e = NULL;
+        {
+            std::lock_guard<std::mutex> lock(_effectPoolLock);
+            auto it = _effectPool.find(effect.GetTemplate());
+            if (it != _effectPool.end() && !it->second.empty())
             {
-                auto& plist = _inUse[p->GetEffectLayer()][p->GetLayer()];
-                plist.erase(p->GetIter());
+                e = it->second.back();
+                it->second.pop_back();
+            }
+        }
+
+        if (e && e->Reuse(effect))
+            return e;
+        delete e;                                   // not the same effect anymore
+
+        e = new Effect(effect, this);
+        if (!e->IsSuper())
+            e->SetPooled();
+        return e;
+    }
+
+    void ParticleManager::ReleaseEffect( Effect *effect )
+    {
+        assert(effect->_pooled && effect->GetParticleManager() == this);
+
+        std::lock_guard<std::mutex> lock(_effectPoolLock);
+        _effectPool[effect->GetTemplate()].push_back(effect);
+    }
+
+    void ParticleManager::ClearEffectPool()
+    {
+        // the effects are deleted outside the lock, so the updating threads only wait for the swap
+        std::unordered_map<const Effect*, std::vector<Effect*> > pool;
+        {
+            std::lock_guard<std::mutex> lock(_effectPoolLock);
+            pool.swap(_effectPool);
+        }
+        for (auto it = pool.begin(); it != pool.end(); ++it)
+        {
+            for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2)
+            {
+                delete *it2;
             }
         }
     }
@@ -362,6 +767,52 @@ namespace TLFX
     {
         return (int)_unused.size();
     }
+
+    int ParticleManager::GetParticleCapacity() const
+    {
+        return _particleLimit;
+    }
+
+    void ParticleManager::SetParticleBudget( int budget )
+    {
+        _particleBudget = std::max(0, std::min(budget, _particleLimit));
+    }
+
+    int ParticleManager::GetParticleBudget() const
+    {
+        return _particleBudget;
+    }
+
+    void ParticleManager::SetPoolPolicy( PoolPolicy policy )
+    {
+        assert(policy >= 0 && policy < PoolPolicyCount);
+        _poolPolicy = policy;
+        _victims.clear();
+        _victimsTick = -1;
+    }
+
+    ParticleManager::PoolPolicy ParticleManager::GetPoolPolicy() const
+    {
+        return _poolPolicy;
+    }
+
+    int ParticleManager::GetPoolCounter( PoolPolicy policy ) const
+    {
+        assert(policy >= 0 && policy < PoolPolicyCount);
+        return _poolCounters[policy];
+    }
+
+    void ParticleManager::ResetPoolCounters()
+    {
+        for (int i = 0; i < PoolPolicyCount; ++i)
+            _poolCounters[i] = 0;
+        _grabCounter = 0;
+    }
+
+    int ParticleManager::GetGrabCounter() const
+    {
+        return _grabCounter;
+    }
 	
 	int ParticleManager::GetEffectCount()
 	{
@@ -400,23 +851,35 @@ namespace TLFX
 		return effectNames;
 	}
 
-    void ParticleManager::AddPreLoadedEffect( Effect* e, int frames, int layer /*= 0*/ )
+    void ParticleManager::AddPreLoadedEffect( Effect* e, int frames, int layer /*= 0*/, bool fastForward /*= false*/ )
     {
         if (layer >= _effectLayers)
             layer = 0;
 
+        SeedEffect(e);
+
+        // the clock of the particles is the tick (see GetCurrentTime), rewind both
         float tempTime = _currentTime;
+        int tempTick = _currentTick;
         _currentTime -= frames * EffectsLibrary::GetUpdateTime();
-        e->ChangeDoB(_currentTime);
+        _currentTick -= frames;
+        e->ChangeDoB(GetCurrentTime());
 
+        _fastForward = fastForward;
         for (int i = 0; i < frames; ++i)
         {
-            _currentTime = (frames + 1) * EffectsLibrary::GetUpdateTime();
+            _currentTime += EffectsLibrary::GetUpdateTime();
+            ++_currentTick;
             e->Update();
             if (e->IsDestroyed())
                 RemoveEffect(e);
         }
+        _fastForward = false;
+        if (fastForward)
+            e->FastForwardParticles();
+
         _currentTime = tempTime;
+        _currentTick = tempTick;
         e->SetEffectLayer(layer);
         _effects[layer].insert(e);
     }
@@ -437,10 +900,101 @@ namespace TLFX
         }
         else
         {
+            SeedEffect(e);
             _effects[layer].insert(e);
         }
     }
 
+    Effect* ParticleManager::Spawn( const char *name, float x, float y, int layer /*= 0*/ )
+    {
+        Effect *effect = _library ? _library->GetEffect(name) : NULL;
+        if (!effect)
+            return NULL;
+        return Spawn(*effect, x, y, layer);
+    }
+
+    Effect* ParticleManager::Spawn( const Effect& effect, float x, float y, int layer /*= 0*/ )
+    {
+        if (effect._isSuper)
+        {
+            // a copy of the group would never be freed, AddEffect only keeps the grouped effects
+            Effect *first = NULL;
+            for (auto it = effect._effects.begin(); it != effect._effects.end(); ++it)
+            {
+                Effect *e = Spawn(**it, x, y, layer);
+                if (!first)
+                    first = e;
+            }
+            return first;
+        }
+
+        Effect *e = GrabEffect(effect);
+        e->SetPosition(x, y);
+        AddEffect(e, layer);
+        return e;
+    }
+
+    bool ParticleManager::Prewarm( const char *name, int count, int subEffects /*= 0*/ )
+    {
+        Effect *effect = _library ? _library->GetEffect(name) : NULL;
+        if (!effect)
+            return false;
+        Prewarm(*effect, count, subEffects);
+        return true;
+    }
+
+    void ParticleManager::Prewarm( const Effect& effect, int count, int subEffects /*= 0*/ )
+    {
+        if (effect._isSuper)
+        {
+            for (auto it = effect._effects.begin(); it != effect._effects.end(); ++it)
+                Prewarm(**it, count, subEffects);
+            return;
+        }
+
+        if (count > 0)
+        {
+            std::vector<Effect*> copies;
+            copies.reserve(count);
+            for (int i = 0; i < count; ++i)
+            {
+                // dead already, like the copies given back by Dispose
+                Effect *e = new Effect(effect, this);
+                e->SetPooled();
+                e->Destroy();
+                copies.push_back(e);
+            }
+
+            std::lock_guard<std::mutex> lock(_effectPoolLock);
+            std::vector<Effect*>& pool = _effectPool[effect.GetTemplate()];
+            pool.insert(pool.end(), copies.begin(), copies.end());
+        }
+
+        if (subEffects > 0)
+        {
+            // Emitter
+            for (auto it = effect._children.begin(); it != effect._children.end(); ++it)
+            {
+                // Effect
+                const std::list<Effect*>& effects = static_cast<Emitter*>(*it)->GetEffects();
+                for (auto it2 = effects.begin(); it2 != effects.end(); ++it2)
+                {
+                    Prewarm(**it2, subEffects, subEffects);
+                }
+            }
+        }
+    }
+
+    void ParticleManager::SetEffectsLibrary( EffectsLibrary *library )
+    {
+        _library = library;
+    }
+
+    EffectsLibrary* ParticleManager::GetEffectsLibrary() const
+    {
+        return _library;
+    }
+
     void ParticleManager::RemoveEffect( Effect* e )
     {
         _effects[e->GetEffectLayer()].erase(e);
@@ -450,6 +1004,7 @@ namespace TLFX
     {
         ClearAll();
         ClearInUse();
+        ClearEffectPool();
     }
 
     void ParticleManager::ClearAll()
@@ -459,7 +1014,7 @@ namespace TLFX
             for (auto it = _effects[el].begin(); it != _effects[el].end(); ++it)
             {
                 (*it)->Destroy();
-                delete *it;
+                (*it)->Dispose();
             }
             _effects[el].clear();
         }
@@ -473,14 +1028,15 @@ namespace TLFX
             {
                 auto& plist = _inUse[el][i];
                 // Particle
-                for (auto it = plist.begin(); it != plist.end(); ++it)
+                while (!plist.empty())
                 {
-                    _unused.push(*it);
+                    Particle *p = plist.front();
+                    plist.erase(p);
+                    p->SetUnused(true);
+                    _unused.push_back(p);
                     --_inUseCount;
-                    (*it)->GetEmitter()->GetParentEffect()->RemoveInUse((*it)->GetLayer(), *it);
-                    (*it)->Reset();
+                    p->Reset();
                 }
-                plist.clear();
             }
         }
     }
@@ -492,7 +1048,7 @@ namespace TLFX
         for (auto it = _effects[layer].begin(); it != _effects[layer].end(); ++it)
         {
             (*it)->Destroy();
-            delete (*it);
+            (*it)->Dispose();
         }
         _effects[layer].clear();
     }
@@ -7,21 +7,22 @@
 
 #include "TLFXMatrix2.h"
 #include "TLFXVector2.h"
+#include "TLFXParticle.h"
+#include "TLFXNodeAllocator.h"
 
 #include <vector>
 #include <set>
-#include <list>
-#include <stack>
+#include <unordered_map>
 #include <string>
+#include <mutex>
 
 namespace TLFX
 {
 
-    class Particle;
     class Effect;
+    class EffectsLibrary;
     class AnimImage;
-	
-	typedef std::list<Particle*> ParticleList;
+    class TaskPool;
 
     /**
      * Particle manager for managing a list of effects and all the emitters and particles they contain
@@ -68,11 +69,27 @@ namespace TLFX
     {
     public:
         static const int   particleLimit;
+
+        typedef std::set<Effect*, std::less<Effect*>, NodeAllocator<Effect*> > EffectSet;
 		
 		// true: create particles whenever there aren't enough in _unused
 		// false: when _unused is empty, stop creating particles
+		// only used as the default #PoolPolicy of new managers (PoolGrow or PoolDrop)
 		static bool createParticlesAsNeeded;
 
+        /**
+         * What to do when an emitter needs a particle and the pool is exhausted (see #SetPoolPolicy)
+         */
+        enum PoolPolicy
+        {
+            PoolGrow,                       // allocate a new particle, the budget is ignored (legacy behaviour)
+            PoolDrop,                       // don't spawn the particle
+            PoolRecycleOldest,              // recycle the oldest particle in use
+            PoolRecycleLeastVisible,        // recycle the particle in use with the lowest alpha x size
+            PoolStealLowestLayer,           // recycle the oldest particle of the lowest effect layer in use
+            PoolPolicyCount
+        };
+
         /**
          * Create a new Particle Manager
          * Creates a new particle manager and sets the maximum number of particles. Default maximum is 5000.
@@ -86,10 +103,48 @@ namespace TLFX
          */
         virtual void Update();
 
+        /**
+         * Update the Particle Manager with the real time elapsed since the last call
+         * The time is accumulated and as many fixed ticks of EffectsLibrary::GetUpdateTime() as it holds are run with #Update, so the
+         * simulation keeps its own rate whatever the frame rate is. At most #GetMaxCatchUpTicks ticks are run per call, after a long stall
+         * the time that can't be caught up with is dropped rather than stalling the app further.
+         * Returns the tween to pass to #DrawParticles: the fraction of a tick left in the accumulator.
+         * &{<pre>
+         * float tween = myParticleManager->Update(secondsSinceLastFrame);
+         * myParticleManager->DrawParticles(tween);</pre>
+         * }
+         */
+        float Update(double elapsedSeconds);
+
+        /**
+         * Set the maximum number of ticks #Update(double) runs in one call, 5 by default
+         */
+        void SetMaxCatchUpTicks(int ticks);
+        int GetMaxCatchUpTicks() const;
+
         Particle* GrabParticle(Effect *effect, bool pool, int layer = 0);
 
         void ReleaseParticle(Particle *p);
 
+        /**
+         * Get a copy of an effect from the pool of its library effect, or a new one when the pool is empty
+         * <p>The copies taken from the pool are restarted in place instead of being copied again (see Effect::Reuse). When they die they
+         * go back to the pool instead of being deleted (see Effect::Dispose). The emitters use it for the sub effects of their particles.
+         * A super effect is copied whole and not pooled, #Spawn grabs its grouped effects one by one instead.</p>
+         */
+        Effect* GrabEffect(const Effect& effect);
+
+        /**
+         * Give a dead effect taken by #GrabEffect back to the pool
+         */
+        void ReleaseEffect(Effect *effect);
+
+        /**
+         * Delete the pooled effects
+         * The pools are kept by library effect, call it before the library effects are deleted or loaded again.
+         */
+        void ClearEffectPool();
+
         /**
          * Draw all particles currently in use
          * Draws all particles in use and uses the tween value you pass to use render tween in order to smooth out the movement of effects assuming you
@@ -206,6 +261,61 @@ namespace TLFX
          */
         int GetParticlesUnused() const;
 
+        /**
+         * Get the number of particles preallocated by the manager
+         * All particles come from one slab allocated when the manager is created, only #PoolGrow can allocate more.
+         */
+        int GetParticleCapacity() const;
+
+        /**
+         * Set the hard budget of particles in use
+         * When the number of particles in use reaches the budget, the pool is considered exhausted and the #PoolPolicy decides what happens
+         * to new spawns. The budget is clamped to #GetParticleCapacity and defaults to it. It is ignored by #PoolGrow.
+         */
+        void SetParticleBudget(int budget);
+        int GetParticleBudget() const;
+
+        /**
+         * Set what happens when the pool is exhausted
+         * Recycling policies never take particles that have sub effects attached or that belong to single particle emitters. If no particle
+         * can be recycled the spawn is dropped. Defaults to #PoolGrow or #PoolDrop depending on #createParticlesAsNeeded.
+         */
+        void SetPoolPolicy(PoolPolicy policy);
+        PoolPolicy GetPoolPolicy() const;
+
+        /**
+         * Get the pool counter of a policy
+         * #PoolGrow counts the particles allocated outside of the slab, #PoolDrop the spawns that were dropped and the other policies the
+         * particles they recycled. Counters are kept for all policies, so they stay meaningful if the policy is changed at run time.
+         */
+        int GetPoolCounter(PoolPolicy policy) const;
+        void ResetPoolCounters();
+
+        /**
+         * Get the number of particles grabbed since the last #ResetPoolCounters, that is the particles actually spawned (dropped spawns
+         * aren't counted)
+         */
+        int GetGrabCounter() const;
+
+        /**
+         * Set the number of threads #Update uses
+         * With 1 or more threads the top-level effects of a layer are updated as separate tasks on a work-stealing TaskPool, the calling
+         * thread being one of the threads. While the tasks run, the particles they grab and release go through a cache per task, the caches
+         * are merged back in effect order once the layer is done so the particle lists end up in the same order as with the serial update.
+         * With 1 thread the tasks run in order on the calling thread. 0, the default, is the plain serial update.
+         * With other policies than #PoolGrow the effects compete for the particle budget in update order, so the update stays serial.
+         * Every effect draws its random numbers from its own generator (see Effect::SetSeed), so the result doesn't depend on the number
+         * of threads.
+         */
+        void SetUpdateThreads(int threads);
+        int GetUpdateThreads() const;
+
+        /**
+         * Get the thread pool used by #Update, NULL if the update is serial (see #SetUpdateThreads)
+         * Emitters also use it to process large numbers of particles in chunks, see Emitter::UpdateParticles.
+         */
+        TaskPool* GetTaskPool() const;
+
 		/**
 		 * Get the current number of effects in all layers
 		 */
@@ -222,16 +332,55 @@ namespace TLFX
          * In most cases the overhead for this will be small, but for extremely heavy effects with many particles you may experience some performance hit.
          * Use this instead of #AddEffect if you want to pre load an effect. If the particle manager has more then one layer, then you can specify
          * which layer the effect is added to. If the layer you pass does not exist then it will default to 0.
+         * With fastForward the particles of the emitters that can (see Emitter::CanFastForward) are only spawned and aged during the pre load
+         * and their state is evaluated once at the end from the compiled curves, the other emitters are stepped as usual. The evaluation still
+         * replays every tick a particle lived, from the table rows, unless its velocity, direction, weight, spin and framerate curves are
+         * constant and the global velocity and spin don't change: only then are the ticks added up at once. So the pre load cost still grows
+         * with the number of frames, it is only cheaper per tick. The result only approximates the stepped one when the global attributes of
+         * the effect change over its life.
          */
-        void AddPreLoadedEffect(Effect* effect, int frames, int layer = 0);
+        void AddPreLoadedEffect(Effect* effect, int frames, int layer = 0, bool fastForward = false);
+
+        /**
+         * Whether #AddPreLoadedEffect is fast-forwarding an effect
+         */
+        bool IsFastForwarding() const { return _fastForward; }
 
         /**
          * Adds a new effect to the particle manager
          * Use this method to add new effects to the particle manager which will be updated automatically. If the particle manager has more 
          * then one layer, then you can specify which layer the effect is added to. If the layer you pass does not exist then it will default to 0.
+         * An effect without a seed gets one from rand() here.
          */
         void AddEffect(Effect* effect, int layer = 0);
 
+        /**
+         * Add a copy of an effect of the library, taken from the pool of the effect
+         * <p>The fire and forget way to add effects: the copy goes back to the pool instead of being deleted when it dies, and the next
+         * #Spawn of the effect restarts it without allocating anything (see #GrabEffect). Don't keep the effect returned once it is
+         * dead. #Prewarm fills the pool beforehand.</p>
+         * <p>A super effect isn't copied, each of its grouped effects is spawned instead.</p>
+         * @return The effect added, the first grouped effect for a super effect, or NULL if the library (see #SetEffectsLibrary) has no
+         * effect with that name
+         */
+        Effect* Spawn(const char *name, float x, float y, int layer = 0);
+        Effect* Spawn(const Effect& effect, float x, float y, int layer = 0);
+
+        /**
+         * Put copies of an effect of the library in its pool
+         * Use it when the library is loaded so that #Spawn allocates nothing later.
+         * @param count The number of copies of the effect, or of each of its grouped effects for a super effect
+         * @param subEffects The number of copies of each of the sub effects spawned by the particles of its emitters, recursively
+         */
+        bool Prewarm(const char *name, int count, int subEffects = 0);
+        void Prewarm(const Effect& effect, int count, int subEffects = 0);
+
+        /**
+         * Set the library #Spawn and #Prewarm look the effects up in
+         */
+        void SetEffectsLibrary(EffectsLibrary *library);
+        EffectsLibrary* GetEffectsLibrary() const;
+
         /**
          * Removes an effect from the particle manager
          * Use this method to remove effects from the particle manager. It's best to destroy the effect as well to avoid memory leaks
@@ -246,7 +395,7 @@ namespace TLFX
 
         /**
          * Destroy the particle manager
-         * This will destroy the particle, clearing all effects and particles. Use only when you are finished with the particle manager and want it removed
+         * This will destroy the particle, clearing all effects, particles and pooled effects. Use only when you are finished with the particle manager and want it removed
          * to avoid any memory leaks.
          */
         void Destroy();
@@ -301,10 +450,52 @@ namespace TLFX
 
     protected:
         std::vector<std::vector<ParticleList> > _inUse;
-        std::stack<Particle*>                _unused;
+        std::vector<Particle*>               _unused;     // free particles, used as a stack
         int                                  _inUseCount; // the Particle doesn't have to be managed by ParticleManager (seed GrabParticle)
-
-        std::vector<std::set<Effect*> >      _effects;
+        int                                  _particleLimit;
+
+        Particle*                            _slab;       // preallocated particles
+        int                                  _particleBudget;
+        PoolPolicy                           _poolPolicy;
+        int                                  _poolCounters[PoolPolicyCount];
+        int                                  _grabCounter;
+
+        struct Victim
+        {
+            Particle*   p;
+            float       dob;                              // to detect particles that died and were spawned again
+            float       key1, key2;                       // lower is recycled first
+
+            bool operator<(const Victim& o) const { return key1 < o.key1 || (key1 == o.key1 && key2 < o.key2); }
+        };
+        std::vector<Victim>                  _victims;    // recycling candidates, best one last
+        int                                  _victimsTick;
+
+        // parallel update
+        struct UpdateContext
+        {
+            ParticleManager*            owner;
+            std::vector<Particle*>      unused;           // particles the task grabs from, at most 2 * contextChunk
+            std::vector<Particle*>      released;         // particles released while in the shared lists, unlinked when merging
+            std::vector<ParticleList>   inUse;            // particles grabbed by the task, [effect layer * 10 + layer]
+            int                         inUseDelta;
+            int                         grown;            // particles allocated because the pool was empty
+            int                         grabbed;
+            bool                        alive;            // what Effect::Update returned
+        };
+        static const size_t                  contextChunk = 64; // particles moved between a context and _unused at once
+        TaskPool*                            _taskPool;
+        int                                  _updateThreads;
+        std::vector<UpdateContext*>          _contexts;   // one per task
+        std::vector<Effect*>                 _tasks;
+        std::mutex                           _unusedLock; // _unused while the tasks run
+        static thread_local UpdateContext*   _updateContext; // context of the task running on this thread
+
+        std::vector<EffectSet>               _effects;
+
+        std::unordered_map<const Effect*, std::vector<Effect*> > _effectPool; // dead copies by library effect, see GrabEffect
+        EffectsLibrary*                      _library;    // see Spawn
+        std::mutex                           _effectPoolLock; // sub effects are spawned by the tasks too
 
         float                                _originX, _originY, _originZ;
         float                                _oldOriginX, _oldOriginY, _oldOriginZ;
@@ -335,12 +526,23 @@ namespace TLFX
         int                                  _currentTick;
         int                                  _idleTimeLimit; // The time in game ticks before idle effects are automatically deleted
 
+        double                               _accumulator;     // real time not simulated yet by Update(double), in milliseconds
+        int                                  _maxCatchUpTicks;
+        bool                                 _fastForward;
+
         int                                  _renderCount;
         float                                _currentTween;
 
         int                                  _effectLayers;
 
         // internal methods
+        Particle* RecycleParticle();
+        void CollectVictims();
+        void UpdateLayer(int layer);
+        void UpdateLayerParallel(int layer);
+        static void UpdateTask(void *arg, int index);
+        void MergeContexts(int count);
+        UpdateContext* GetUpdateContext() const;
         void DrawEffects();
         void DrawEffect(Effect *effect);
         void DrawParticle(Particle *particle);
@@ -2,58 +2,66 @@
 #include "TLFXAnimImage.h"
 #include "TLFXEffect.h"
 #include "TLFXEmitter.h"
+#include "TLFXZipArchive.h"
 
 #include <sys/types.h>
 #include <cassert>
-
-#include "vogl_miniz_zip.h"
+#include <cstring>
 
 namespace TLFX
 {
 
+    PugiXMLLoader::~PugiXMLLoader()
+    {
+        if (_ownArchive)
+            delete _archive;
+    }
+
     bool PugiXMLLoader::Open( const char *filename )
     {
         _error[0] = 0;
 
-        if (_library) {
-
-            struct zip_archive_t {
-                zip_archive_t() { memset(&za, 0, sizeof(mz_zip_archive)); }
-                ~zip_archive_t() { mz_zip_reader_end(&za); }
-                mz_bool init_file(const char *fn) { return mz_zip_reader_init_file(&za, fn); }
-                mz_zip_archive * operator &() { return &za; }
-                mz_zip_archive za;
-            } zip_archive;
-            
-            // Now try to open the archive.
-            mz_bool status = zip_archive.init_file(_library);
-            if (status)
+        if (_library && !_archive)
+        {
+            _archive = new ZipArchive();
+            _ownArchive = true;
+            _archive->Open(_library);
+        }
+
+        if (_archive)
+        {
+            if (!_archive->IsOpen())
             {
-                // Try to extract all the files to the heap.
-                size_t uncomp_size;
-                void *p = mz_zip_extract_file_to_heap(&zip_archive, filename, &uncomp_size, 0);
-                if (p == 0)
-                {
-                    snprintf(_error, sizeof(_error), "Failed to extract %s!", filename);
-                    return false;
-                }
-
-                printf("[PugiXMLLoader] Successfully extracted file \"%s\", size %u\n", filename, (uint)uncomp_size);
-
-                pugi::xml_parse_result result = _doc.load_buffer(p, uncomp_size);
-
-                // We're done.
-                mz_free(p);
-
-                if (!result)
-                {
-                    snprintf(_error, sizeof(_error), "Parsing error at #%d : %s", (uint)result.offset, result.description());
-                    return false;
-                }
+                // the archive's message can be as long as ours, keep room for the prefix
+                static const char prefix[] = "Cannot open library file: ";
+                snprintf(_error, sizeof(_error), "%s%.*s", prefix, (int)(sizeof(_error) - sizeof(prefix)), _archive->GetLastError());
+                return false;
             }
-            else
+
+            int index = _archive->Locate(filename);
+            if (index < 0)
             {
-                snprintf(_error, sizeof(_error), "Cannot open library file %s!", _library);
+                snprintf(_error, sizeof(_error), "Failed to extract %s!", filename);
+                return false;
+            }
+
+            // inflated straight into the buffer parsed in place, the document owns it
+            size_t size = _archive->GetEntrySize(index);
+            void *buffer = pugi::get_memory_allocation_function()(size ? size : 1);
+            if (!buffer || !_archive->ExtractTo(index, buffer, size))
+            {
+                if (buffer)
+                    pugi::get_memory_deallocation_function()(buffer);
+                snprintf(_error, sizeof(_error), "Failed to extract %s!", filename);
+                return false;
+            }
+
+            printf("[PugiXMLLoader] Successfully extracted file \"%s\", size %u\n", filename, (uint)size);
+
+            pugi::xml_parse_result result = _doc.load_buffer_inplace_own(buffer, size);
+            if (!result)
+            {
+                snprintf(_error, sizeof(_error), "Parsing error at #%d : %s", (uint)result.offset, result.description());
                 return false;
             }
         } else {
@@ -150,16 +158,7 @@ namespace TLFX
             effect = LoadEffect(_currentEffect, sprites);
 
 
-        _currentEffect = _currentEffect.next_sibling("EFFECT");
-        if (!_currentEffect)
-        {
-            if (_currentFolder)
-            {
-                _currentFolder = _currentFolder.next_sibling("FOLDER");
-                _currentEffect = _currentFolder.child("EFFECT");
-            }
-        }
-
+        NextEffect("EFFECT");
         return effect;
     }
 
@@ -179,17 +178,63 @@ namespace TLFX
             superEffect = LoadSuperEffect(_currentEffect, sprites);
 
         // get next SUPER_EFFECT
-        _currentEffect = _currentEffect.next_sibling("SUPER_EFFECT");
+        NextEffect("SUPER_EFFECT");
+        return superEffect;
+    }
+
+    void PugiXMLLoader::NextEffect( const char *tag )
+    {
+        _currentEffect = _currentEffect.next_sibling(tag);
         if (!_currentEffect)
         {
             if (_currentFolder)
             {
                 _currentFolder = _currentFolder.next_sibling("FOLDER");
-                _currentEffect = _currentFolder.child("SUPER_EFFECT");
+                _currentEffect = _currentFolder.child(tag);
             }
         }
+    }
 
-        return superEffect;
+    bool PugiXMLLoader::IndexEffects( std::vector<std::string>& effects, std::vector<std::string>& superEffects )
+    {
+        // same effects in the same order as GetNextEffect and GetNextSuperEffect
+        const char *tags[2] = { "EFFECT", "SUPER_EFFECT" };
+        std::vector<std::string> *paths[2] = { &effects, &superEffects };
+        for (int t = 0; t < 2; ++t)
+        {
+            if (t == 0)
+                LocateEffect();
+            else
+                LocateSuperEffect();
+
+            for (; _currentEffect; NextEffect(tags[t]))
+            {
+                std::string path = _currentFolder ? _currentFolder.attribute("NAME").as_string() : "";
+                if (!path.empty())
+                    path += "/";
+                path += _currentEffect.attribute("NAME").as_string();
+
+                IndexedNode indexed = { _currentEffect, _currentFolder };
+                _index[path] = indexed;
+                paths[t]->push_back(path);
+            }
+        }
+        return true;
+    }
+
+    Effect* PugiXMLLoader::LoadIndexedEffect( const char *path, const std::list<AnimImage*>& sprites )
+    {
+        auto it = _index.find(path);
+        if (it == _index.end())
+        {
+            snprintf(_error, sizeof(_error), "No effect %s there", path);
+            return NULL;
+        }
+
+        const char *folderPath = it->second.folder ? it->second.folder.attribute("NAME").as_string() : "";
+        if (!strcmp(it->second.node.name(), "SUPER_EFFECT"))
+            return LoadSuperEffect(it->second.node, sprites, NULL, folderPath);
+        return LoadEffect(it->second.node, sprites, NULL, folderPath);
     }
 
     Effect* PugiXMLLoader::LoadSuperEffect( pugi::xml_node& node, const std::list<AnimImage*>& sprites, Emitter *parent, const char *folderPath /*= ""*/ )
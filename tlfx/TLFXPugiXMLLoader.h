@@ -8,16 +8,24 @@
 #include "TLFXXMLLoader.h"
 #include <pugixml.hpp>
 
+#include <map>
+
 namespace TLFX
 {
 
     struct AttributeNode;
+    class ZipArchive;
 
     class PugiXMLLoader : public XMLLoader
     {
     public:
-        PugiXMLLoader(int shapes, const char *libraryfile = 0) : XMLLoader(shapes), _library(libraryfile) {}
-        PugiXMLLoader(const char *libraryfile) : XMLLoader(0), _library(libraryfile) {}
+        PugiXMLLoader(int shapes, const char *libraryfile = 0) : XMLLoader(shapes), _library(libraryfile), _archive(NULL), _ownArchive(false) {}
+        PugiXMLLoader(const char *libraryfile) : XMLLoader(0), _library(libraryfile), _archive(NULL), _ownArchive(false) {}
+        /**
+         * Read the description file from an archive opened already, shared by the library with its images
+         */
+        PugiXMLLoader(int shapes, ZipArchive *archive) : XMLLoader(shapes), _library(NULL), _archive(archive), _ownArchive(false) {}
+        virtual ~PugiXMLLoader();
 
         virtual bool        Open(const char *filename);
         virtual bool        GetNextShape(AnimImage *shape);
@@ -27,10 +35,15 @@ namespace TLFX
         virtual void        LocateEffect();
         virtual void        LocateSuperEffect();
 
+        virtual bool        IndexEffects(std::vector<std::string>& effects, std::vector<std::string>& superEffects);
+        virtual Effect*     LoadIndexedEffect(const char *path, const std::list<AnimImage*>& sprites);
+
         virtual const char* GetLastError() const;
 
     protected:
         const char *_library;
+        ZipArchive *_archive;
+        bool _ownArchive;
 
         char _error[128];
         pugi::xml_document _doc;
@@ -38,11 +51,18 @@ namespace TLFX
         pugi::xml_node _currentEffect;              // can be in root or in a folder
         pugi::xml_node _currentFolder;
 
+        struct IndexedNode
+        {
+            pugi::xml_node node, folder;
+        };
+        std::map<std::string, IndexedNode> _index;  // effects and super effects by path, for LoadIndexedEffect
+
         Effect*    LoadEffect       (pugi::xml_node& node, const std::list<AnimImage*>& sprites, Emitter *parent = NULL, const char *folderPath = "");
         Effect*    LoadSuperEffect  (pugi::xml_node& node, const std::list<AnimImage*>& sprites, Emitter *parent = NULL, const char *folderPath = "");
         void       LoadAttributeNode(pugi::xml_node& node, AttributeNode* attr);
         Emitter*   LoadEmitter      (pugi::xml_node& node, const std::list<AnimImage*>& sprites, Effect *parent);
         AnimImage* GetSpriteInList  (const std::list<AnimImage*>& sprites, int index) const;
+        void       NextEffect       (const char *tag);
     };
 
 } // namespace TLFX
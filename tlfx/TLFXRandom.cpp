@@ -0,0 +1,60 @@
+#include "TLFXRandom.h"
+
+namespace TLFX
+{
+
+    namespace
+    {
+        inline unsigned int rotl(unsigned int x, int k)
+        {
+            return (x << k) | (x >> (32 - k));
+        }
+    }
+
+    Random::Random( unsigned int seed /*= 0*/ )
+    {
+        Seed(seed);
+    }
+
+    void Random::Seed( unsigned int seed )
+    {
+        // spread the seed over the whole state with splitmix64, the state must not be all zeros
+        unsigned long long x = seed;
+        for (int i = 0; i < 4; i += 2)
+        {
+            unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            _state[i] = (unsigned int)z;
+            _state[i + 1] = (unsigned int)(z >> 32);
+        }
+    }
+
+    unsigned int Random::Next()
+    {
+        unsigned int result = rotl(_state[1] * 5, 7) * 9;
+        unsigned int t = _state[1] << 9;
+
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = rotl(_state[3], 11);
+
+        return result;
+    }
+
+    float Random::Rnd( float range )
+    {
+        // the top 24 bits fit the float mantissa exactly
+        return range * ((Next() >> 8) * (1.0f / 16777216.0f));
+    }
+
+    float Random::Rnd( float min, float max )
+    {
+        return (max - min) * ((Next() >> 8) * (1.0f / 16777216.0f)) + min;
+    }
+
+} // namespace TLFX
@@ -0,0 +1,47 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_RANDOM_H
+#define _TLFX_RANDOM_H
+
+namespace TLFX
+{
+
+    /**
+     * Small, fast pseudo random number generator (xoshiro128**)
+     * <p>Every effect owns one, so that the particles of an effect only depend on its seed and not on what the other effects or
+     * threads do with the C library generator. The same seed always gives the same sequence on every platform.</p>
+     */
+    class Random
+    {
+    public:
+        explicit Random(unsigned int seed = 0);
+
+        /**
+         * Restart the sequence from a seed
+         */
+        void Seed(unsigned int seed);
+
+        /**
+         * Next 32 bit number of the sequence
+         */
+        unsigned int Next();
+
+        /**
+         * A random number in [0, range)
+         */
+        float Rnd(float range);
+
+        /**
+         * A random number in [min, max)
+         */
+        float Rnd(float min, float max);
+
+    protected:
+        unsigned int _state[4];
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_RANDOM_H
@@ -0,0 +1,154 @@
+#include "TLFXTaskPool.h"
+
+#include <cassert>
+
+namespace TLFX
+{
+
+    namespace
+    {
+        thread_local bool inTask = false;
+    }
+
+    TaskPool::TaskPool( int threads )
+        : _generation(0)
+        , _working(0)
+        , _quit(false)
+        , _func(NULL)
+        , _arg(NULL)
+    {
+        if (threads < 1)
+            threads = 1;
+
+        for (int t = 0; t < threads; ++t)
+        {
+            Queue *q = new Queue();
+            q->begin = q->end = 0;
+            _queues.push_back(q);
+        }
+        for (int t = 1; t < threads; ++t)
+            _threads.push_back(std::thread(&TaskPool::WorkerLoop, this, t));
+    }
+
+    TaskPool::~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _quit = true;
+        }
+        _wake.notify_all();
+        for (size_t t = 0; t < _threads.size(); ++t)
+            _threads[t].join();
+        for (size_t t = 0; t < _queues.size(); ++t)
+            delete _queues[t];
+    }
+
+    bool TaskPool::IsInTask()
+    {
+        return inTask;
+    }
+
+    void TaskPool::Run( int count, TaskFunc func, void *arg )
+    {
+        if (count <= 0)
+            return;
+
+        std::unique_lock<std::mutex> run(_runLock, std::defer_lock);
+        if (inTask || _threads.empty() || count == 1 || !run.try_lock())
+        {
+            bool wasInTask = inTask;
+            inTask = true;
+            for (int i = 0; i < count; ++i)
+                func(arg, i);
+            inTask = wasInTask;
+            return;
+        }
+
+        // split the range, the workers can't see the queues before the generation changes
+        int threads = (int)_queues.size();
+        for (int t = 0; t < threads; ++t)
+        {
+            _queues[t]->begin = (int)((long long)count * t / threads);
+            _queues[t]->end = (int)((long long)count * (t + 1) / threads);
+        }
+        _func = func;
+        _arg = arg;
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _working = (int)_threads.size();
+            ++_generation;
+        }
+        _wake.notify_all();
+
+        Execute(0);
+
+        std::unique_lock<std::mutex> guard(_lock);
+        while (_working > 0)
+            _done.wait(guard);
+    }
+
+    void TaskPool::WorkerLoop( int thread )
+    {
+        unsigned int generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> guard(_lock);
+                while (!_quit && _generation == generation)
+                    _wake.wait(guard);
+                if (_quit)
+                    return;
+                generation = _generation;
+            }
+
+            Execute(thread);
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                last = --_working == 0;
+            }
+            if (last)
+                _done.notify_one();
+        }
+    }
+
+    void TaskPool::Execute( int thread )
+    {
+        inTask = true;
+        int index;
+        while (Pop(thread, index))
+            _func(_arg, index);
+        inTask = false;
+    }
+
+    bool TaskPool::Pop( int thread, int& index )
+    {
+        // own share first, from the front
+        {
+            Queue *q = _queues[thread];
+            std::lock_guard<std::mutex> guard(q->lock);
+            if (q->begin < q->end)
+            {
+                index = q->begin++;
+                return true;
+            }
+        }
+
+        // then steal from the back of the others
+        int threads = (int)_queues.size();
+        for (int t = 1; t < threads; ++t)
+        {
+            Queue *q = _queues[(thread + t) % threads];
+            std::lock_guard<std::mutex> guard(q->lock);
+            if (q->begin < q->end)
+            {
+                index = --q->end;
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace TLFX
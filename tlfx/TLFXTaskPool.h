@@ -0,0 +1,78 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_TASKPOOL_H
+#define _TLFX_TASKPOOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TLFX
+{
+
+    /**
+     * Small work-stealing thread pool
+     * <p>#Run executes a task for every index of a range and returns when all of them are done. The range is split between the threads,
+     * each thread takes the tasks of its share from the front and, once it runs out, steals from the back of the others' shares, so that
+     * a few expensive tasks don't leave the other threads idle. The calling thread takes a share too.</p>
+     * <p>#Run is not reentrant: calling it from inside a task (or while another thread is in #Run) simply runs the tasks on the calling
+     * thread, in order.</p>
+     */
+    class TaskPool
+    {
+    public:
+        typedef void (*TaskFunc)(void *arg, int index);
+
+        /**
+         * @param threads The number of threads running the tasks, including the calling thread
+         */
+        explicit TaskPool(int threads);
+        ~TaskPool();
+
+        int GetThreadCount() const { return (int)_queues.size(); }
+
+        /**
+         * Run func(arg, index) for every index in [0, count) and wait for all of them
+         */
+        void Run(int count, TaskFunc func, void *arg);
+
+        /**
+         * Whether the calling thread is running tasks of a pool
+         */
+        static bool IsInTask();
+
+    protected:
+        struct Queue
+        {
+            std::mutex  lock;
+            int         begin, end;             // tasks left in this share
+        };
+
+        void WorkerLoop(int thread);
+        void Execute(int thread);
+        bool Pop(int thread, int& index);
+
+        std::vector<std::thread>    _threads;
+        std::vector<Queue*>         _queues;    // one per thread, the calling thread uses the first one
+
+        std::mutex                  _lock;
+        std::condition_variable     _wake;
+        std::condition_variable     _done;
+        unsigned int                _generation;
+        int                         _working;   // workers still running the current generation
+        bool                        _quit;
+
+        std::mutex                  _runLock;   // one Run at a time
+        TaskFunc                    _func;
+        void*                       _arg;
+
+        TaskPool(const TaskPool&);
+        TaskPool& operator=(const TaskPool&);
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_TASKPOOL_H
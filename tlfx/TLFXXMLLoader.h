@@ -5,8 +5,10 @@
 #ifndef _TLFX_XMLLOADER_H
 #define _TLFX_XMLLOADER_H
 
+#include <cstddef>
 #include <string>
 #include <list>
+#include <vector>
 
 namespace TLFX
 {
@@ -28,6 +30,14 @@ namespace TLFX
         virtual void        LocateEffect() = 0;
         virtual void        LocateSuperEffect() = 0;
 
+        /**
+         * Lazy loading, see EffectsLibrary::Load
+         * #IndexEffects lists the paths of the effects and super effects of the file without loading them, #LoadIndexedEffect loads one of
+         * them later on, as long as the loader is alive. Loaders that can't do that return false and the whole file is loaded.
+         */
+        virtual bool        IndexEffects(std::vector<std::string>&, std::vector<std::string>&) { return false; }
+        virtual Effect*     LoadIndexedEffect(const char*, const std::list<AnimImage*>&) { return NULL; }
+
         virtual const char* GetLastError() const { return "no error reporting implemented"; }
 		
 		int _existingShapeCount;
@@ -0,0 +1,170 @@
+#include "TLFXZipArchive.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace TLFX
+{
+
+    namespace
+    {
+        // local file header, see the zip APPNOTE
+        const unsigned int localHeaderSignature = 0x04034b50;
+        const size_t localHeaderSize = 30;
+        const size_t localHeaderNameLength = 26;
+        const size_t localHeaderExtraLength = 28;
+
+        unsigned int ReadLE(const unsigned char *p, int bytes)
+        {
+            unsigned int v = 0;
+            for (int i = bytes - 1; i >= 0; --i)
+                v = (v << 8) | p[i];
+            return v;
+        }
+    }
+
+    ZipArchive::ZipArchive()
+        : _open(false)
+    {
+        memset(&_zip, 0, sizeof(_zip));
+        _error[0] = 0;
+    }
+
+    ZipArchive::~ZipArchive()
+    {
+        Close();
+    }
+
+    bool ZipArchive::Open( const char *filename )
+    {
+        Close();
+
+        if (!_file.Open(filename))
+        {
+            snprintf(_error, sizeof(_error), "%s", _file.GetLastError());
+            return false;
+        }
+        if (!mz_zip_reader_init_mem(&_zip, _file.GetData(), _file.GetSize(), 0))
+        {
+            snprintf(_error, sizeof(_error), "%s is not a zip archive: %s", filename, mz_zip_get_error_string(_zip.m_last_error));
+            _file.Close();
+            return false;
+        }
+
+        _open = true;
+        _filename = filename;
+        return true;
+    }
+
+    void ZipArchive::Close()
+    {
+        if (_open)
+            mz_zip_reader_end(&_zip);
+        memset(&_zip, 0, sizeof(_zip));
+        _file.Close();
+        _open = false;
+        _filename.clear();
+        std::vector<char>().swap(_buffer);
+        _error[0] = 0;
+    }
+
+    int ZipArchive::GetEntryCount() const
+    {
+        return _open ? (int)mz_zip_get_num_files(&_zip) : 0;
+    }
+
+    std::string ZipArchive::GetEntryName( int index ) const
+    {
+        mz_zip_archive_file_stat stat;
+        if (!_open || !mz_zip_file_stat(&_zip, (mz_uint)index, &stat))
+            return "";
+        return stat.m_filename;
+    }
+
+    size_t ZipArchive::GetEntrySize( int index ) const
+    {
+        mz_zip_archive_file_stat stat;
+        if (!_open || !mz_zip_file_stat(&_zip, (mz_uint)index, &stat))
+            return 0;
+        return (size_t)stat.m_uncomp_size;
+    }
+
+    unsigned int ZipArchive::GetEntryCrc( int index ) const
+    {
+        mz_zip_archive_file_stat stat;
+        if (!_open || !mz_zip_file_stat(&_zip, (mz_uint)index, &stat))
+            return 0;
+        return stat.m_crc32;
+    }
+
+    int ZipArchive::Locate( const char *name ) const
+    {
+        mz_uint32 index;
+        if (!_open || !mz_zip_locate_file(&_zip, name, NULL, 0, &index))
+            return -1;
+        return (int)index;
+    }
+
+    const void* ZipArchive::GetStoredData( int index ) const
+    {
+        mz_zip_archive_file_stat stat;
+        if (!_open || index < 0 || !mz_zip_file_stat(&_zip, (mz_uint)index, &stat) || stat.m_method != 0 || stat.m_is_encrypted ||
+            stat.m_comp_size != stat.m_uncomp_size)
+            return NULL;
+
+        // the data follows the local header, which can have another extra field than the central directory
+        const unsigned char *data = (const unsigned char*)_file.GetData();
+        size_t size = _file.GetSize();
+        unsigned long long offset = stat.m_local_header_ofs;
+        if (offset + localHeaderSize > size || ReadLE(data + offset, 4) != localHeaderSignature)
+            return NULL;
+        offset += localHeaderSize + ReadLE(data + offset + localHeaderNameLength, 2) + ReadLE(data + offset + localHeaderExtraLength, 2);
+        if (offset + stat.m_uncomp_size > size)
+            return NULL;
+        return data + offset;
+    }
+
+    const void* ZipArchive::Extract( int index, size_t& size )
+    {
+        size = GetEntrySize(index);
+        if (!_open || index < 0)
+        {
+            snprintf(_error, sizeof(_error), "No entry %d", index);
+            return NULL;
+        }
+
+        const void *stored = GetStoredData(index);
+        if (stored)
+            return stored;
+
+        if (_buffer.size() < size + 1)
+            _buffer.resize(size + 1);
+        if (!ExtractTo(index, &_buffer[0], size))
+            return NULL;
+        return &_buffer[0];
+    }
+
+    const void* ZipArchive::Extract( const char *name, size_t& size )
+    {
+        int index = Locate(name);
+        if (index < 0)
+        {
+            snprintf(_error, sizeof(_error), "No %s in %s", name, _filename.c_str());
+            size = 0;
+            return NULL;
+        }
+        return Extract(index, size);
+    }
+
+    bool ZipArchive::ExtractTo( int index, void *buffer, size_t size )
+    {
+        if (!_open || index < 0 || !mz_zip_extract_to_mem(&_zip, (mz_uint)index, buffer, size, 0))
+        {
+            snprintf(_error, sizeof(_error), "Failed to extract entry %d of %s: %s", index, _filename.c_str(),
+                     mz_zip_get_error_string(_zip.m_last_error));
+            return false;
+        }
+        return true;
+    }
+
+} // namespace TLFX
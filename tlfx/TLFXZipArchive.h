@@ -0,0 +1,83 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_ZIPARCHIVE_H
+#define _TLFX_ZIPARCHIVE_H
+
+#include "TLFXMappedFile.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "vogl_miniz_zip.h"
+
+namespace TLFX
+{
+
+    /**
+     * Effects library archive (.eff)
+     * <p>The archive is mapped in memory once and read from there by the xml loader and the images. Stored entries are used where they are
+     * in the mapping, deflated ones are inflated in a single buffer reused from one entry to the next (see #Extract) or straight into the
+     * caller's memory (see #ExtractTo). Not thread safe.</p>
+     */
+    class ZipArchive
+    {
+    public:
+        ZipArchive();
+        ~ZipArchive();
+
+        bool Open(const char *filename);
+        void Close();
+        bool IsOpen() const { return _open; }
+        const char* GetFilename() const { return _filename.c_str(); }
+
+        int         GetEntryCount() const;
+        std::string GetEntryName(int index) const;
+        size_t      GetEntrySize(int index) const;
+        unsigned int GetEntryCrc(int index) const;  // from the central directory, nothing is read
+        /**
+         * Find an entry by name, case insensitive
+         * @return Its index or -1
+         */
+        int         Locate(const char *name) const;
+
+        /**
+         * Get the content of an entry
+         * <p>Stored entries point into the mapping and stay valid until #Close, deflated entries are inflated in the archive's buffer and
+         * are only valid until the next call.</p>
+         * @return NULL if the entry can't be read
+         */
+        const void* Extract(int index, size_t& size);
+        const void* Extract(const char *name, size_t& size);
+
+        /**
+         * Extract an entry to memory the caller owns, it must hold #GetEntrySize bytes
+         */
+        bool        ExtractTo(int index, void *buffer, size_t size);
+
+        /**
+         * Get the content of a stored entry where it is in the mapping, valid until #Close
+         * @return NULL if the entry is compressed
+         */
+        const void* GetStoredData(int index) const;
+
+        const char* GetLastError() const { return _error; }
+
+    protected:
+        MappedFile _file;
+        mutable mz_zip_archive _zip;        // miniz isn't const correct
+        bool _open;
+        std::string _filename;
+        std::vector<char> _buffer;          // the last inflated entry
+
+        char _error[128];
+
+        ZipArchive(const ZipArchive&);
+        ZipArchive& operator=(const ZipArchive&);
+    };
+
+} // namespace TLFX
+
+#endif // _TLFX_ZIPARCHIVE_H
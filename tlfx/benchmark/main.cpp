@@ -0,0 +1,344 @@
+/*
+ * Replays every effect of a library under a fixed number of ticks with the headless backend and reports the timings as JSON.
+ *
+ * --warmup runs ticks before the measured ones. --respawn adds the instances again every N ticks, the fire and forget way; they are
+ * copied with new and ParticleManager::AddEffect, or taken from the effect pool with ParticleManager::Spawn when --pool gives the number
+ * of copies to prewarm (see ParticleManager::Prewarm), eg. to compare the allocations of both:
+ *
+ * tlfx-bench --instances 1 --warmup 300 --ticks 300 --respawn 30
+ * tlfx-bench --instances 1 --warmup 300 --ticks 300 --respawn 30 --pool 2
+ *
+ * --trig fast switches the sines and cosines of the entities to the polynomial approximation (see Math::SetTrigPrecision).
+ *
+ * tlfx-bench [--data data.xml] [--library file.eff] [--compiled file.tlfxc] [--instances N] [--ticks N] [--warmup N] [--respawn N] [--pool N] [--seed N] [--threads N] [--trig precise|fast] [--output file.json]
+ */
+
+#include "TLFXNullEffectsLibrary.h"
+#include "TLFXEffect.h"
+#include "TLFXEmitter.h"
+#include "TLFXEmitterArray.h"
+#include "TLFXKernels.h"
+#include "TLFXMath.h"
+#include "counting_new.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#ifndef TLFX_DATA_DIR
+#define TLFX_DATA_DIR "data/particles"
+#endif
+
+// peak resident set size in kilobytes, 0 if unknown
+static long __peakRSS()
+{
+#if defined(__APPLE__)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : 0;
+#elif defined(__unix__)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#else
+    return 0;
+#endif
+}
+
+static std::string __jsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        char c = s[i];
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+struct Result
+{
+    std::string name;
+    double updateNs;                // total time in ParticleManager::Update
+    double drawNs;                  // total time in ParticleManager::DrawParticles
+    unsigned long long particleTicks;   // sum over the ticks of the particles in use
+    unsigned long long sprites;     // sprites submitted by DrawParticles
+    int peakParticles;
+    unsigned long long allocations; // operator new calls during the ticks
+
+    double UpdateNsPerParticleTick() const { return particleTicks ? updateNs / particleTicks : 0; }
+    double DrawNsPerParticle() const { return sprites ? drawNs / sprites : 0; }
+};
+
+struct Options
+{
+    int instances, ticks, warmup, respawn, pool, seed, threads;
+};
+
+static void __addInstances(TLFX::ParticleManager &pm, const TLFX::Effect &effect, const Options &o,
+                           std::mt19937 &positions, std::uniform_real_distribution<float> &px, std::uniform_real_distribution<float> &py)
+{
+    for (int i = 0; i < o.instances; ++i)
+    {
+        float x = px(positions), y = py(positions);
+        if (o.pool >= 0)
+        {
+            pm.Spawn(effect, x, y);
+        }
+        else
+        {
+            TLFX::Effect *e = new TLFX::Effect(effect, &pm);
+            e->SetPosition(x, y);
+            pm.AddEffect(e);
+        }
+    }
+}
+
+static Result __run(TLFX::EffectsLibrary &lib, const std::string &name, const Options &o)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Result r;
+    r.name = name;
+    r.updateNs = r.drawNs = 0;
+    r.particleTicks = r.sprites = r.allocations = 0;
+    r.peakParticles = 0;
+
+    // same positions and same simulation for the same seed
+    srand(o.seed);
+    std::mt19937 positions(o.seed);
+    std::uniform_real_distribution<float> px(-300.0f, 300.0f), py(-200.0f, 200.0f);
+
+    TLFX::NullParticleManager pm(TLFX::ParticleManager::particleLimit * 10, 1);
+    pm.SetScreenSize(800, 600);
+    pm.SetUpdateThreads(o.threads);
+    const TLFX::Effect &effect = *lib.GetEffect(name.c_str());
+    if (o.pool > 0)
+        pm.Prewarm(effect, o.pool, o.pool * 4);
+
+    unsigned long long allocations = 0;
+    long sprites = 0;
+    for (int t = 0; t < o.warmup + o.ticks; ++t)
+    {
+        if (t == 0 || (o.respawn > 0 && t % o.respawn == 0))
+            __addInstances(pm, effect, o, positions, px, py);
+        if (t == o.warmup)
+        {
+            allocations = GetAllocationCount();
+            sprites = pm.GetSpritesDrawn();
+        }
+        if (t < o.warmup)
+        {
+            pm.Update();
+            pm.DrawParticles();
+            continue;
+        }
+
+        Clock::time_point t0 = Clock::now();
+        pm.Update();
+        Clock::time_point t1 = Clock::now();
+        pm.DrawParticles();
+        Clock::time_point t2 = Clock::now();
+
+        int inUse = pm.GetParticlesInUse();
+        r.particleTicks += inUse;
+        if (inUse > r.peakParticles)
+            r.peakParticles = inUse;
+        r.updateNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        r.drawNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+    }
+    r.allocations = GetAllocationCount() - allocations;
+    r.sprites = pm.GetSpritesDrawn() - sprites;
+
+    pm.Destroy();
+    return r;
+}
+
+// number of attribute arrays of each shape (see EmitterArray::GetShape) in the effects and emitters of the library
+static void __countCurves(TLFX::EffectsLibrary &lib, unsigned long long shapes[3])
+{
+    shapes[0] = shapes[1] = shapes[2] = 0;
+    for (size_t i = 0; i < lib.AllEffects().size(); ++i)
+    {
+        TLFX::Effect *effect = lib.GetEffect(lib.AllEffects()[i].c_str());
+        if (!effect)
+            continue;
+
+        TLFX::EmitterArray *effectArrays[TLFX::Effect::arrayCount];
+        effect->GetArrays(effectArrays);
+        for (int a = 0; a < TLFX::Effect::arrayCount; ++a)
+            ++shapes[effectArrays[a]->GetShape()];
+
+        const TLFX::Entity::ChildList &emitters = effect->GetChildren();
+        for (auto it = emitters.begin(); it != emitters.end(); ++it)
+        {
+            TLFX::EmitterArray *emitterArrays[TLFX::Emitter::arrayCount];
+            static_cast<TLFX::Emitter*>(*it)->GetArrays(emitterArrays);
+            for (int a = 0; a < TLFX::Emitter::arrayCount; ++a)
+                ++shapes[emitterArrays[a]->GetShape()];
+        }
+    }
+}
+
+static void __usage()
+{
+    fprintf(stderr, "usage: tlfx-bench [--data data.xml] [--library file.eff] [--compiled file.tlfxc] [--instances N] [--ticks N] [--warmup N] [--respawn N] [--pool N] [--seed N] [--threads N] [--trig precise|fast] [--output file.json]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string data = TLFX_DATA_DIR "/data.xml", library, compiled, output;
+    Options o;
+    o.instances = 10;
+    o.ticks = 300;
+    o.warmup = 0;
+    o.respawn = 0;
+    o.pool = -1;
+    o.seed = 1;
+    o.threads = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            __usage();
+            return 1;
+        }
+        if (!strcmp(arg, "--data"))
+            data = argv[++i];
+        else if (!strcmp(arg, "--library"))
+            library = argv[++i];
+        else if (!strcmp(arg, "--compiled"))
+            compiled = argv[++i];
+        else if (!strcmp(arg, "--instances"))
+            o.instances = atoi(argv[++i]);
+        else if (!strcmp(arg, "--ticks"))
+            o.ticks = atoi(argv[++i]);
+        else if (!strcmp(arg, "--warmup"))
+            o.warmup = atoi(argv[++i]);
+        else if (!strcmp(arg, "--respawn"))
+            o.respawn = atoi(argv[++i]);
+        else if (!strcmp(arg, "--pool"))
+            o.pool = atoi(argv[++i]);
+        else if (!strcmp(arg, "--seed"))
+            o.seed = atoi(argv[++i]);
+        else if (!strcmp(arg, "--threads"))
+            o.threads = atoi(argv[++i]);
+        else if (!strcmp(arg, "--trig"))
+        {
+            const char *trig = argv[++i];
+            if (!strcmp(trig, "fast"))
+                TLFX::Math::SetTrigPrecision(TLFX::Math::TrigFast);
+            else if (strcmp(trig, "precise"))
+            {
+                __usage();
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--output"))
+            output = argv[++i];
+        else
+        {
+            __usage();
+            return 1;
+        }
+    }
+
+    TLFX::NullEffectsLibrary lib(library.empty() ? NULL : library.c_str());
+    const std::string &source = compiled.empty() ? data : compiled;
+    std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+    if (!(compiled.empty() ? lib.Load(data.c_str()) : lib.LoadCompiled(compiled.c_str())))
+    {
+        fprintf(stderr, "[tlfx-bench] Cannot load %s\n", source.c_str());
+        return 1;
+    }
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+    unsigned long long shapes[3];
+    __countCurves(lib, shapes);
+
+    std::vector<Result> results;
+    for (size_t i = 0; i < lib.AllEffects().size(); ++i)
+    {
+        const std::string &name = lib.AllEffects()[i];
+        TLFX::Effect *effect = lib.GetEffect(name.c_str());
+        if (!effect || effect->GetParentEmitter())     // sub effects are replayed by their parents
+            continue;
+        results.push_back(__run(lib, name, o));
+    }
+
+    Result total;
+    total.updateNs = total.drawNs = 0;
+    total.particleTicks = total.sprites = total.allocations = 0;
+    total.peakParticles = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        total.updateNs += results[i].updateNs;
+        total.drawNs += results[i].drawNs;
+        total.particleTicks += results[i].particleTicks;
+        total.sprites += results[i].sprites;
+        total.allocations += results[i].allocations;
+        if (results[i].peakParticles > total.peakParticles)
+            total.peakParticles = results[i].peakParticles;
+    }
+
+    std::string json = "{\n";
+    char buf[512];
+    snprintf(buf, sizeof(buf), "  \"instances\": %d,\n  \"ticks\": %d,\n  \"warmup\": %d,\n  \"respawn\": %d,\n  \"pool\": %d,\n  \"seed\": %d,\n"
+             "  \"threads\": %d,\n  \"kernels\": \"%s\",\n  \"trig\": \"%s\",\n  \"load_ms\": %.3f,\n",
+             o.instances, o.ticks, o.warmup, o.respawn, o.pool, o.seed, o.threads, TLFX::Kernels::GetInstructionSet(),
+             TLFX::Math::GetTrigPrecision() == TLFX::Math::TrigFast ? "fast" : "precise", loadMs);
+    json += buf;
+    snprintf(buf, sizeof(buf), "  \"update_ns_per_particle_tick\": %.3f,\n  \"draw_ns_per_particle\": %.3f,\n  \"peak_particles\": %d,\n"
+             "  \"allocations\": %llu,\n  \"peak_rss_kb\": %ld,\n",
+             total.UpdateNsPerParticleTick(), total.DrawNsPerParticle(), total.peakParticles, total.allocations, __peakRSS());
+    json += buf;
+    snprintf(buf, sizeof(buf), "  \"curves\": {\"constant\": %llu, \"linear\": %llu, \"tabled\": %llu},\n",
+             shapes[TLFX::EmitterArray::Constant], shapes[TLFX::EmitterArray::Linear], shapes[TLFX::EmitterArray::Tabled]);
+    json += buf;
+    json += "  \"effects\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        snprintf(buf, sizeof(buf), "\"update_ns_per_particle_tick\": %.3f, \"draw_ns_per_particle\": %.3f, \"peak_particles\": %d, \"sprites\": %llu, \"allocations\": %llu}",
+                 r.UpdateNsPerParticleTick(), r.DrawNsPerParticle(), r.peakParticles, r.sprites, r.allocations);
+        json += "    {\"name\": " + __jsonString(r.name) + ", " + buf + (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json += "  ]\n}\n";
+
+    if (output.empty())
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        FILE *f = fopen(output.c_str(), "w");
+        if (!f)
+        {
+            fprintf(stderr, "[tlfx-bench] Cannot write %s\n", output.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), f);
+        fclose(f);
+    }
+    return 0;
+}
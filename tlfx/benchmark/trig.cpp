@@ -0,0 +1,133 @@
+/*
+ * Times the sine and cosine of angles in degrees: sinf/cosf one angle at a time (what Math::SinCos does in TrigPrecise mode),
+ * Math::FastSinCos one angle at a time, and Math::SinCosArray in both modes. Reports ns per angle and the largest error against
+ * the double precision sin/cos as JSON.
+ *
+ * tlfx-bench-trig [--count N] [--rounds N] [--seed N]
+ */
+
+#include "TLFXMath.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// keeps the results alive so the loops aren't optimized away
+static volatile float __sink;
+
+struct Result
+{
+    double ns;                          // per angle, best round
+    double maxError;                    // against sin/cos in double precision
+};
+
+template <class F>
+static Result __time(F f, const std::vector<float> &degrees, std::vector<float> &s, std::vector<float> &c, int rounds)
+{
+    Result r;
+    r.ns = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f(&degrees[0], &s[0], &c[0], (int)degrees.size());
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / degrees.size();
+        if (round == 0 || ns < r.ns)
+            r.ns = ns;
+        __sink = s[round % s.size()] + c[round % c.size()];
+    }
+
+    r.maxError = 0;
+    for (size_t i = 0; i < degrees.size(); ++i)
+    {
+        double rad = degrees[i] / 180.0 * M_PI;
+        double es = fabs(s[i] - sin(rad)), ec = fabs(c[i] - cos(rad));
+        if (es > r.maxError) r.maxError = es;
+        if (ec > r.maxError) r.maxError = ec;
+    }
+    return r;
+}
+
+static void __sinCosf(const float *degrees, float *s, float *c, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        s[i] = sinf(degrees[i] / 180.0f * (float)M_PI);
+        c[i] = cosf(degrees[i] / 180.0f * (float)M_PI);
+    }
+}
+
+static void __fastSinCos(const float *degrees, float *s, float *c, int count)
+{
+    for (int i = 0; i < count; ++i)
+        TLFX::Math::FastSinCos(degrees[i], s[i], c[i]);
+}
+
+static void __arrayPrecise(const float *degrees, float *s, float *c, int count)
+{
+    TLFX::Math::SetTrigPrecision(TLFX::Math::TrigPrecise);
+    TLFX::Math::SinCosArray(degrees, s, c, count);
+}
+
+static void __arrayFast(const float *degrees, float *s, float *c, int count)
+{
+    TLFX::Math::SetTrigPrecision(TLFX::Math::TrigFast);
+    TLFX::Math::SinCosArray(degrees, s, c, count);
+}
+
+static void __usage()
+{
+    fprintf(stderr, "usage: tlfx-bench-trig [--count N] [--rounds N] [--seed N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int count = 4096, rounds = 2000, seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            __usage();
+            return 1;
+        }
+        if (!strcmp(arg, "--count"))
+            count = atoi(argv[++i]);
+        else if (!strcmp(arg, "--rounds"))
+            rounds = atoi(argv[++i]);
+        else if (!strcmp(arg, "--seed"))
+            seed = atoi(argv[++i]);
+        else
+        {
+            __usage();
+            return 1;
+        }
+    }
+    if (count < 1 || rounds < 1)
+    {
+        __usage();
+        return 1;
+    }
+
+    // directions and angles of the particles are mostly within a turn or two either way
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> angle(-720.0f, 720.0f);
+    std::vector<float> degrees(count), s(count), c(count);
+    for (int i = 0; i < count; ++i)
+        degrees[i] = angle(rng);
+
+    Result sinCosf = __time(__sinCosf, degrees, s, c, rounds);
+    Result fastSinCos = __time(__fastSinCos, degrees, s, c, rounds);
+    Result arrayPrecise = __time(__arrayPrecise, degrees, s, c, rounds);
+    Result arrayFast = __time(__arrayFast, degrees, s, c, rounds);
+
+    printf("{\n  \"count\": %d,\n  \"rounds\": %d,\n  \"seed\": %d,\n", count, rounds, seed);
+    printf("  \"sinf_cosf\": {\"ns_per_angle\": %.3f, \"max_error\": %.3g},\n", sinCosf.ns, sinCosf.maxError);
+    printf("  \"fast_sincos\": {\"ns_per_angle\": %.3f, \"max_error\": %.3g},\n", fastSinCos.ns, fastSinCos.maxError);
+    printf("  \"sincos_array_precise\": {\"ns_per_angle\": %.3f, \"max_error\": %.3g},\n", arrayPrecise.ns, arrayPrecise.maxError);
+    printf("  \"sincos_array_fast\": {\"ns_per_angle\": %.3f, \"max_error\": %.3g}\n}\n", arrayFast.ns, arrayFast.maxError);
+    return 0;
+}
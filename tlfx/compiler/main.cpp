@@ -0,0 +1,55 @@
+/*
+ * Compiles an effects library to the binary format of TLFX::CompiledLibrary, for EffectsLibrary::LoadCompiled.
+ *
+ * tlfx-compile [--library file.eff] data.xml output.tlfxc
+ */
+
+#include "TLFXNullEffectsLibrary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static void __usage()
+{
+    fprintf(stderr, "usage: tlfx-compile [--library file.eff] data.xml output.tlfxc\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string library, data, output;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--library") && i + 1 < argc)
+            library = argv[++i];
+        else if (data.empty())
+            data = argv[i];
+        else if (output.empty())
+            output = argv[i];
+        else
+        {
+            __usage();
+            return 1;
+        }
+    }
+    if (data.empty() || output.empty())
+    {
+        __usage();
+        return 1;
+    }
+
+    // the images are only needed by the renderer, the headless library doesn't decode them
+    TLFX::NullEffectsLibrary lib(library.empty() ? NULL : library.c_str());
+    if (!lib.Load(data.c_str()))
+    {
+        fprintf(stderr, "[tlfx-compile] Cannot load %s\n", data.c_str());
+        return 1;
+    }
+    if (!lib.SaveCompiled(output.c_str()))
+    {
+        fprintf(stderr, "[tlfx-compile] Cannot write %s\n", output.c_str());
+        return 1;
+    }
+    return 0;
+}
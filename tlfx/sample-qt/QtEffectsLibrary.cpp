@@ -1,6 +1,7 @@
 
 #include "QtEffectsLibrary.h"
 #include "TLFXPugiXMLLoader.h"
+#include "TLFXTaskPool.h"
 
 #include <QFile>
 #include <QDir>
@@ -12,15 +13,19 @@
 #include <QScreen>
 #include <QDesktopWidget>
 #include <QApplication>
+#include <QThread>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #include <stdint.h>
 #include <cmath>
+#include <vector>
 
 #include "qgeometry/qglpainter.h"
 #include "qgeometry/qglbuilder.h"
 
-#include "vogl_miniz_zip.h"
-
 /** KDE effect code */
 static void __toGray(QImage &img, float value);
 static void __toGray2(QImage &img);
@@ -40,8 +45,10 @@ bool QtImage::Load()
 }
 
 
-QtEffectsLibrary::QtEffectsLibrary() : _atlas(0)
+QtEffectsLibrary::QtEffectsLibrary() : _archive(0), _atlas(0)
 {
+    _atlasCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
     if (qApp == 0)
         qWarning() << "[QtEffectsLibrary] Application is not initialized.";
     else
@@ -52,6 +59,8 @@ QtEffectsLibrary::QtEffectsLibrary() : _atlas(0)
 
 QtEffectsLibrary::~QtEffectsLibrary()
 {
+    TLFX::EffectsLibrary::ClearAll();
+    delete _archive;
     delete _atlas;
 }
 
@@ -59,57 +68,46 @@ bool QtEffectsLibrary::LoadLibrary(const char *library, const char *filename /*
 {
     QString libraryinfo = filename;
 
-    struct zip_archive_t {
-        zip_archive_t() { memset(&za, 0, sizeof(mz_zip_archive)); }
-        ~zip_archive_t() { mz_zip_reader_end(&za); }
-        mz_bool init_file(const char *fn) { return mz_zip_reader_init_file(&za, fn); }
-        mz_zip_archive * operator &() { return &za; }
-        mz_zip_archive za;
-    } zip_archive;
-
-    // Now try to open the archive.
-    mz_bool status = zip_archive.init_file(library);
-    if (!status)
+    // Now try to open the archive, once for the description and the images.
+    TLFX::ZipArchive *archive = new TLFX::ZipArchive;
+    if (!archive->Open(library))
     {
-        qWarning() << "[QtEffectsLibrary] Cannot open effects library" << library;
+        qWarning() << "[QtEffectsLibrary] Cannot open effects library" << library << archive->GetLastError();
+        delete archive;
         return false;
     }
     
     if (libraryinfo.isEmpty())
     {
         // Try to locate effect data file.
-        for (int i = 0; i < (int)mz_zip_get_num_files(&zip_archive); i++)
+        for (int i = 0; i < archive->GetEntryCount(); i++)
         {
-            mz_zip_archive_file_stat file_stat;
-            if (!mz_zip_file_stat(&zip_archive, i, &file_stat))
-            {
-                qWarning() << "[QtEffectsLibrary] Cannot read effects library!";
-                return false;
-            }
-            if(libraryinfo.isEmpty() && strcasestr(file_stat.m_filename, "data.xml"))
+            std::string name = archive->GetEntryName(i);
+            if(strcasestr(name.c_str(), "data.xml"))
             {
-                libraryinfo = file_stat.m_filename;
+                libraryinfo = QString::fromStdString(name);
                 break;
             }
-            // qDebug("Filename: \"%s\", Comment: \"%s\", Uncompressed size: %u, Compressed size: %u, Is Dir: %u\n", file_stat.m_filename, file_stat.m_comment, (uint)file_stat.m_uncomp_size, (uint)file_stat.m_comp_size, mz_zip_is_file_a_directory(&zip_archive, i));
         }
     }
 
     if (libraryinfo.isEmpty())
     {
         qWarning() << "[QtEffectsLibrary] Cannot find library description file!";
+        delete archive;
         return false;
     }
 
     // Keep library we are using for effects
-    _library = library;
+    delete _archive;
+    _archive = archive;
 
     return Load(libraryinfo.toUtf8().constData(), compile);
 }
 
 TLFX::XMLLoader* QtEffectsLibrary::CreateLoader() const
 {
-    return new TLFX::PugiXMLLoader(_library.isEmpty()?0:_library.toUtf8().constData());
+    return new TLFX::PugiXMLLoader(0, _archive);
 }
 
 TLFX::AnimImage* QtEffectsLibrary::CreateImage() const
@@ -136,6 +134,139 @@ bool QtEffectsLibrary::ensureTextureSize(int &w, int &h)
     return true; // scale
 }
 
+// one shape's texture, decoded and scaled on the task pool
+struct TextureJob
+{
+    TLFX::AnimImage *shape;
+    QSize size;                         // in the atlas
+    QString file;                       // read from disk, or
+    int entry;                          // from the archive:
+    const void *data;                   // stored entries are in its mapping,
+    size_t dataSize;
+    QByteArray inflated;                // compressed ones are inflated here
+    QImage image;
+};
+
+static void __decodeTexture(void *arg, int index)
+{
+    TextureJob &job = static_cast<TextureJob*>(arg)[index];
+
+    QImage img = job.data ? QImage::fromData((const uchar *)job.data, (int)job.dataSize) : QImage(job.file);
+    if (img.isNull())
+        return;
+    switch (job.shape->GetImportOpt()) {
+        case QtImage::impGreyScale:  __toGray2(img); break;
+        case QtImage::impFullColour: break;
+        case QtImage::impPassThrough: break;
+        default: break;
+    }
+    // scale images to fit atlas
+    job.image = img.scaled(job.size);
+}
+
+// Baked atlas: the atlas image with the rect of each texture, see UploadTextures
+static const quint32 __atlasMagic = 0x41464c54; // TLFA
+static const quint32 __atlasVersion = 1;
+
+static bool __loadAtlas(QAtlasManager *atlas, const QString &path, std::vector<TextureJob> &jobs)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    qint32 count;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != __atlasMagic || version != __atlasVersion || count != (qint32)jobs.size())
+        return false;
+    QVector<QRect> rects(count);
+    for (int i = 0; i < count; ++i)
+        in >> rects[i];
+    qint32 w, h;
+    in >> w >> h;
+    if (in.status() != QDataStream::Ok || QSize(w, h) != atlas->atlasTextureSize())
+        return false;
+    QImage image(w, h, QImage::Format_ARGB32_Premultiplied);
+    const int bytes = image.bytesPerLine() * h;
+    if (image.isNull() || in.readRawData((char *)image.bits(), bytes) != bytes)
+        return false;
+
+    // same sizes in the same order, the allocator gives the same rects
+    QList<QTexture *> textures;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        QTexture *texture = atlas->create(jobs[i].size);
+        if (texture == 0 || texture->atlasSubRect() != rects[(int)i])
+        {
+            qWarning() << "[QtEffectsLibrary] Texture atlas" << path << "doesn't match, baking it again";
+            delete texture;
+            qDeleteAll(textures);
+            return false;
+        }
+        textures << texture;
+    }
+    atlas->setAtlasImage(image);
+    for (size_t i = 0; i < jobs.size(); ++i)
+        dynamic_cast<QtImage*>(jobs[i].shape)->SetTexture(textures[(int)i], jobs[i].shape->GetFilename());
+    return true;
+}
+
+static void __saveAtlas(QAtlasManager *atlas, const QString &path, const std::vector<TextureJob> &jobs)
+{
+    QImage image = atlas->atlasImage();
+    if (image.isNull())
+        return; // uploaded already, with other textures
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "[QtEffectsLibrary] Cannot write texture atlas" << path;
+        return;
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << __atlasMagic << __atlasVersion << qint32(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i)
+        out << dynamic_cast<QtImage*>(jobs[i].shape)->GetTexture()->atlasSubRect();
+    out << qint32(image.width()) << qint32(image.height());
+    out.writeRawData((const char *)image.constBits(), image.bytesPerLine() * image.height());
+    if (!f.commit())
+        qWarning() << "[QtEffectsLibrary] Cannot write texture atlas" << path;
+    else
+        qDebug() << "[QtEffectsLibrary] Texture atlas baked to" << path;
+}
+
+QSize QtEffectsLibrary::shapeTextureSize(TLFX::AnimImage *shape, qreal sc, int minw, int maxw)
+{
+#define SC(x) (sc/(1.1+(x-minw)/(maxw-minw))) // 1-2
+    const int anim_size = powf(2, ceilf(log2f(shape->GetFramesCount())));
+    const int anim_square = sqrtf(anim_size);
+    int w = shape->GetWidth()*anim_square;
+    int h = shape->GetHeight()*anim_square;
+    if(ensureTextureSize(w, h))
+    {
+        w *= SC(w);
+        h *= SC(h);
+    }
+#undef SC
+    return QSize(w, h);
+}
+
+bool QtEffectsLibrary::shapesFit(qreal sc, int minw, int maxw)
+{
+    QGL::QAreaAllocator m_allocator(_atlas->atlasTextureSize(), _atlas->padding);
+    Q_FOREACH(TLFX::AnimImage *shape, _shapeList)
+    {
+        QRect rc = m_allocator.allocate(shapeTextureSize(shape, sc, minw, maxw));
+        if (rc.width() == 0 || rc.height() == 0)
+            return false;
+    }
+    return true;
+}
+
 bool QtEffectsLibrary::UploadTextures()
 {
     // try calculate best fit into current atlas texture:
@@ -149,135 +280,66 @@ bool QtEffectsLibrary::UploadTextures()
         if (w > maxw) maxw = w;
         if (h > maxh) maxh = h;
     }
-#define SC(x) (sc/(1.1+(x-minw)/(maxw-minw))) // 1-2
-    qreal sc = 1.5; bool done = false; while(!done && sc > 0)
+    // The largest scale, 1.5 down in 0.05 steps, the sizes fit the atlas with: the layout only depends on the sizes
+    // so the allocator is dry run on them before any pixel is decoded. The steps are bisected, which assumes that
+    // smaller shapes always pack, but the allocator's placement isn't strictly monotonic, so the steps above the
+    // bisected one are tried again as long as they fit.
+    const qreal maxScale = 1.5, scaleStep = 0.05;
+    const int steps = 30;
+    int first = 0, last = steps;
+    while (first < last)
     {
-        QGL::QAreaAllocator m_allocator(_atlas->atlasTextureSize(), _atlas->padding);
-        qDebug() << "[QtEffectsLibrary] Scaling texture atlas with" << sc;
-        done = true; Q_FOREACH(TLFX::AnimImage *shape, _shapeList)
-        {
-            const int anim_size = powf(2, ceilf(log2f(shape->GetFramesCount())));
-            const int anim_square = sqrtf(anim_size);
-            int w = shape->GetWidth()*anim_square;
-            int h = shape->GetHeight()*anim_square;
-            if(ensureTextureSize(w, h))
-            {
-                w *= SC(w);
-                h *= SC(h);
-            }
-            QRect rc = m_allocator.allocate(QSize(w, h));
-            if (rc.width() == 0 || rc.height() == 0) 
-            {
-                sc -= 0.05; done = false; break; // next step
-            }
-        }
+        const int step = (first + last) / 2;
+        if (shapesFit(maxScale - step * scaleStep, minw, maxw))
+            last = step;
+        else
+            first = step + 1;
     }
-    if (!done) {
+    while (first > 0 && first < steps && shapesFit(maxScale - (first - 1) * scaleStep, minw, maxw))
+        --first;
+    if (first == steps) {
         qDebug() << "[QtEffectsLibrary] Cannot build texture atlas.";
         return false;
     }
-    if (!_library.isEmpty()) 
+    const qreal sc = maxScale - first * scaleStep;
+    qDebug() << "[QtEffectsLibrary] Scaling texture atlas with" << sc;
+
+    // Find the images, ...
+    std::vector<TextureJob> jobs;
+    jobs.reserve(_shapeList.size());
+    Q_FOREACH(TLFX::AnimImage *shape, _shapeList)
     {
-        struct zip_archive_t {
-            zip_archive_t() { memset(&za, 0, sizeof(mz_zip_archive)); }
-            ~zip_archive_t() { mz_zip_reader_end(&za); }
-            mz_bool init_file(const char *fn) { return mz_zip_reader_init_file(&za, fn); }
-            mz_zip_archive * operator &() { return &za; }
-            mz_zip_archive za;
-        } zip_archive;
-        
-        // Now try to open the archive.
-        mz_bool status = zip_archive.init_file(_library.toUtf8().constData());
-        if (status)
+        const char *filename = shape->GetFilename();
+        TextureJob job;
+        job.shape = shape;
+        job.size = shapeTextureSize(shape, sc, minw, maxw);
+        job.entry = -1;
+        job.data = 0;
+        job.dataSize = 0;
+
+        if (_archive) 
         {
-            Q_FOREACH(TLFX::AnimImage *shape, _shapeList)
+            if (filename==0 || strlen(filename)==0)
             {
-                const char *filename = shape->GetFilename();
-                const int anim_size = powf(2, ceilf(log2f(shape->GetFramesCount())));
-                const int anim_square = sqrtf(anim_size);
-                int w = shape->GetWidth()*anim_square;
-                int h = shape->GetHeight()*anim_square;
-                if(ensureTextureSize(w, h))
-                {
-                    w *= SC(w);
-                    h *= SC(h);
-                }
-
-                if (filename==0 || strlen(filename)==0)
-                {
-                    qWarning() << "[QtEffectsLibrary] Empty image filename";
-                    continue;
-                }
-                // Try to extract all the files to the heap.
-                QStringList variants; 
-                variants
-                    << filename
-                    << QFileInfo(filename).fileName()
-                    << QFileInfo(QString(filename).replace("\\","/")).fileName();
-                Q_FOREACH(QString fn, variants)
-                {
-                    size_t uncomp_size;
-                    void *p = mz_zip_extract_file_to_heap(&zip_archive, fn.toUtf8().constData(), &uncomp_size, 0);
-                    if (p == 0) 
-                    {
-                        continue; // Try next name
-                    }
-
-                    qDebug() << "[QtEffectsLibrary] Successfully extracted file" << fn << uncomp_size << "bytes";
-
-                    QImage img = QImage::fromData((const uchar *)p, uncomp_size);
-
-                    if (img.isNull())
-                    {
-                        qWarning() << "[QtEffectsLibrary] Failed to create image:" << filename;
-                        return false;
-                    }
-                    else
-                    {
-                        switch (shape->GetImportOpt()) {
-                            case QtImage::impGreyScale:  __toGray2(img); break;
-                            case QtImage::impFullColour: break;
-                            case QtImage::impPassThrough: break;
-                            default: break;
-                        }
-
-                        // scale images to fit atlas
-                        QTexture *texture = _atlas->create(img.scaled(QSize(w,h)));
-                        dynamic_cast<QtImage*>(shape)->SetTexture(texture, filename);
-                        if (texture == 0) {
-                            qWarning() << "[QtEffectsLibrary] Failed to create texture for image" << filename << img.size() << QString("%1 frames").arg(shape->GetFramesCount());
-                            return false;
-                        } else
-                            break;
-                    }                    
-                    // We're done.
-                    mz_free(p);
-                }
-                if (0 == dynamic_cast<QtImage*>(shape)->GetTexture()) 
-                {
-                    qWarning() << "[QtEffectsLibrary] Failed to extract file" << filename;
-                    return false;
-                }
+                qWarning() << "[QtEffectsLibrary] Empty image filename";
+                continue;
             }
-            return true;
-        } else {
-            qWarning() << "[QtEffectsLibrary] Cannot open library file" << _library;
-            return false;
-        }
-    } else {
-        Q_FOREACH(TLFX::AnimImage *shape, _shapeList)
-        {
-            const char *filename = shape->GetFilename();
-            const int anim_size = powf(2, ceilf(log2f(shape->GetFramesCount())));
-            const int anim_square = sqrtf(anim_size);
-            int w = shape->GetWidth()*anim_square;
-            int h = shape->GetHeight()*anim_square;
-            if(ensureTextureSize(w, h))
+            QStringList variants; 
+            variants
+                << filename
+                << QFileInfo(filename).fileName()
+                << QFileInfo(QString(filename).replace("\\","/")).fileName();
+            Q_FOREACH(QString fn, variants)
             {
-                w *= SC(w);
-                h *= SC(h);
+                if ((job.entry = _archive->Locate(fn.toUtf8().constData())) >= 0)
+                    break; // Try next name otherwise
             }
-
+            if (job.entry < 0)
+            {
+                qWarning() << "[QtEffectsLibrary] Failed to extract file" << filename;
+                return false;
+            }
+        } else {
             QFile f(filename);
             if (!f.exists())
                 f.setFileName(QString(":/data/%1").arg(filename));
@@ -285,34 +347,102 @@ bool QtEffectsLibrary::UploadTextures()
                 qWarning() << "[QtImage] Failed to load image:" << filename;
                 return false;
             }
-            QImage img(f.fileName());
-            if (img.isNull())
+            job.file = f.fileName();
+        }
+        jobs.push_back(job);
+    }
+
+    // ... take the atlas baked by a previous run if nothing changed since, ...
+    QString cache;
+    if (!_atlasCacheDir.isEmpty() && !jobs.empty())
+    {
+        cache = QString("%1/tlfx-atlas-%2.bin").arg(_atlasCacheDir).arg(QString(atlasKey(jobs).toHex()));
+        if (__loadAtlas(_atlas, cache, jobs))
+        {
+            qDebug() << "[QtEffectsLibrary] Texture atlas loaded from" << cache;
+            return true;
+        }
+    }
+
+    // ... read them, stored images are decoded where they are in the mapped archive, the others are inflated once, ...
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        TextureJob &job = jobs[i];
+        if (job.entry < 0)
+            continue;
+        job.dataSize = _archive->GetEntrySize(job.entry);
+        if (!(job.data = _archive->GetStoredData(job.entry)))
+        {
+            job.inflated.resize((int)job.dataSize);
+            if (!_archive->ExtractTo(job.entry, job.inflated.data(), job.dataSize))
             {
-                qWarning() << "[QtImage] Failed to load image:" << filename;
+                qWarning() << "[QtEffectsLibrary] Failed to extract file" << job.shape->GetFilename() << _archive->GetLastError();
                 return false;
             }
-            else
-            {
-                switch (shape->GetImportOpt()) {
-                    case QtImage::impGreyScale:  __toGray2(img); break;
-                    case QtImage::impFullColour: break;
-                    case QtImage::impPassThrough: break;
-                    default: break;
-                }
+            job.data = job.inflated.constData();
+        }
+        qDebug() << "[QtEffectsLibrary] Successfully extracted file" << job.shape->GetFilename() << job.dataSize << "bytes";
+    }
 
-                // scale images to fit atlas
-                QTexture *texture = _atlas->create(img.scaled(QSize(w,h)));
-                dynamic_cast<QtImage*>(shape)->SetTexture(texture, filename);
-                if (texture == 0) {
-                    qWarning() << "[QtImage] Failed to create texture for image" << filename << img.size() << QString("%1 frames").arg(shape->GetFramesCount());
-                    return false;
-                }
-            }
+    // ... decode, convert and scale them in parallel ...
+    if (!jobs.empty())
+    {
+        TLFX::TaskPool pool(qMin(QThread::idealThreadCount(), (int)jobs.size()));
+        pool.Run((int)jobs.size(), __decodeTexture, &jobs[0]);
+    }
+
+    // ... and put them in the atlas in the shapes order.
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        TextureJob &job = jobs[i];
+        const char *filename = job.shape->GetFilename();
+        if (job.image.isNull())
+        {
+            qWarning() << (_archive ? "[QtEffectsLibrary] Failed to create image:" : "[QtImage] Failed to load image:") << filename;
+            return false;
+        }
+        QTexture *texture = _atlas->create(job.image);
+        dynamic_cast<QtImage*>(job.shape)->SetTexture(texture, filename);
+        if (texture == 0) {
+            qWarning() << "[QtEffectsLibrary] Failed to create texture for image" << filename << job.image.size() << QString("%1 frames").arg(job.shape->GetFramesCount());
+            return false;
         }
     }
+
+    if (!cache.isEmpty())
+        __saveAtlas(_atlas, cache, jobs);
     return true;
 }
 
+QByteArray QtEffectsLibrary::atlasKey(const std::vector<TextureJob> &jobs) const
+{
+    // everything the atlas pixels and layout depend on
+    QByteArray key;
+    QDataStream ks(&key, QIODevice::WriteOnly);
+    ks << __atlasMagic << __atlasVersion << qint32(QSysInfo::ByteOrder)
+       << _atlas->atlasTextureSize() << QAtlasManager::padding << qint32(_atlas->atlasTextureSizeLimit());
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const TextureJob &job = jobs[i];
+        ks << QString(job.shape->GetFilename()) << job.size << qint32(job.shape->GetImportOpt());
+        if (job.entry >= 0)
+            ks << quint64(_archive->GetEntrySize(job.entry)) << quint32(_archive->GetEntryCrc(job.entry));
+        else if (job.file.startsWith(":"))
+        {
+            // resources have no date
+            QFile f(job.file);
+            if (f.open(QIODevice::ReadOnly))
+                ks << QCryptographicHash::hash(f.readAll(), QCryptographicHash::Sha1);
+        }
+        else
+        {
+            QFileInfo fi(job.file);
+            ks << quint64(fi.size()) << fi.lastModified();
+        }
+    }
+    return QCryptographicHash::hash(key, QCryptographicHash::Sha1);
+}
+
 void QtEffectsLibrary::Debug(QGLPainter *p)
 {
     Q_FOREACH(TLFX::AnimImage *sprite, _shapeList)
@@ -11,10 +11,13 @@
 #include <QColor>
 #include <QPointer>
 
+#include <vector>
+
 #include "TLFXEffectsLibrary.h"
 #include "TLFXParticleManager.h"
 #include "TLFXAnimImage.h"
 #include "TLFXParticle.h"
+#include "TLFXZipArchive.h"
 
 #include "qgeometry/qgeometrydata.h"
 #include "qgeometry/qatlastexture.h"
@@ -22,6 +25,7 @@
 class QOpenGLTexture;
 class QGLPainter;
 class XMLLoader;
+struct TextureJob;
 
 class QtImage : public TLFX::AnimImage
 {
@@ -58,13 +62,25 @@ public:
     QSize TextureAtlasSize() const { return _atlas->atlasTextureSize(); }
 
     bool ensureTextureSize(int &w, int &h);
+    /**
+     * Build the texture atlas of the shapes
+     * The atlas is baked to the cache dir the first time, keyed by the images, their sizes and the atlas settings,
+     * and later loads upload that one image instead of decoding the shapes again.
+     */
     bool UploadTextures();
+    // empty to disable the baked atlases, the application's cache location by default
+    void SetAtlasCacheDir(const QString &dir) { _atlasCacheDir = dir; }
 
     void Debug(QGLPainter *p);
 
 protected:
-    QString _library;
+    QSize shapeTextureSize(TLFX::AnimImage *shape, qreal sc, int minw, int maxw);
+    bool shapesFit(qreal sc, int minw, int maxw);
+    QByteArray atlasKey(const std::vector<TextureJob> &jobs) const;
+
+    TLFX::ZipArchive *_archive;             // the effects library, 0 when loading from files
     QAtlasManager *_atlas;
+    QString _atlasCacheDir;
 };
 
 class QtParticleManager : public TLFX::ParticleManager
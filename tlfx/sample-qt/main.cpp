@@ -141,6 +141,7 @@ private:
     QGLPainter m_p;
     QSize m_size;
     QMatrix4x4 m_projm;
+    QElapsedTimer m_clock; // real time between frames for the particle manager
 public:
 	QPoint cursorPos;
 public:
@@ -155,6 +156,7 @@ public:
 		, m_done(false) {
 		setSurfaceType(QWindow::OpenGLSurface);
         setMinimumSize(QSize(400,200));
+        m_clock.start();
 	}
 	~Window() { delete m_surf; delete m_fbo; delete m_device; }
 	
@@ -169,14 +171,14 @@ public:
         
         guard.lock();
 
-        m_pm->Update();
+        float tween = m_pm->Update(m_clock.restart() / 1000.0);
 
         m_p.begin(m_surf);
         m_p.projectionMatrix() = m_projm;
         m_p.setStandardEffect(QGL::VertColorTexture2D);
         glClearColor(0,0,0,0);
 		glClear(GL_COLOR_BUFFER_BIT);
-        m_pm->DrawParticles();
+        m_pm->DrawParticles(tween);
         m_pm->Flush();
         //m_effects->Debug(&m_p);
         m_p.disableEffect();
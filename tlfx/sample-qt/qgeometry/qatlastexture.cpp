@@ -362,6 +362,27 @@ QTexture *QAtlasManager::create(const QImage &image)
     return m_atlas->create(image);
 }
 
+QTexture *QAtlasManager::create(const QSize &size)
+{
+    if (size.width() > m_atlas_size_limit || size.height() > m_atlas_size_limit)
+        return 0;
+    if (!m_atlas)
+        m_atlas = new QTextureAtlas(m_atlas_size);
+    return m_atlas->create(size);
+}
+
+void QAtlasManager::setAtlasImage(const QImage &image)
+{
+    if (!m_atlas)
+        m_atlas = new QTextureAtlas(m_atlas_size);
+    m_atlas->setImage(image);
+}
+
+QImage QAtlasManager::atlasImage() const
+{
+    return m_atlas ? m_atlas->toImage() : QImage();
+}
+
 GLuint QAtlasManager::atlasTextureId() const { return m_atlas->textureId(); }
 
 QSize QAtlasManager::atlasTextureSize() const { return m_atlas_size; }
@@ -451,6 +472,57 @@ QTexture *QTextureAtlas::create(const QImage &image)
     return 0;
 }
 
+// the image with its edges repeated in the padding around it
+static void drawPadded(QPainter &p, const QImage &image, const QPoint &o, const QSize &size)
+{
+    int w = size.width();
+    int h = size.height();
+    int iw = image.width();
+    int ih = image.height();
+    int x = o.x();
+    int y = o.y();
+
+    p.drawImage(x + 1, y + 1, image);
+    p.drawImage(x + 1, y, image, 0, 0, iw, 1);
+    p.drawImage(x + 1, y + h - 1, image, 0, ih - 1, iw, 1);
+    p.drawImage(x, y + 1, image, 0, 0, 1, ih);
+    p.drawImage(x + w - 1, y + 1, image, iw - 1, 0, 1, ih);
+    p.drawImage(x, y, image, 0, 0, 1, 1);
+    p.drawImage(x, y + h - 1, image, 0, ih - 1, 1, 1);
+    p.drawImage(x + w - 1, y, image, iw - 1, 0, 1, 1);
+    p.drawImage(x + w - 1, y + h - 1, image, iw - 1, ih - 1, 1, 1);
+}
+
+QTexture *QTextureAtlas::create(const QSize &size)
+{
+    QRect rect = m_allocator.allocate(size);
+    if (rect.width() > 0 && rect.height() > 0)
+        return new QTexture(this, rect, QImage());
+    return 0;
+}
+
+void QTextureAtlas::setImage(const QImage &image)
+{
+    m_pending_image = image;
+}
+
+QImage QTextureAtlas::toImage() const
+{
+    if (m_allocated)
+        return QImage();
+
+    QImage atlas(m_size, QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(0);
+    QPainter p(&atlas);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    for (int i=0; i<m_pending_uploads.size(); ++i) {
+        QTexture *t = m_pending_uploads.at(i);
+        drawPadded(p, t->image(), t->atlasSubRect().topLeft(), t->atlasSubRect().size());
+    }
+    p.end();
+    return atlas;
+}
+
 
 int QTextureAtlas::textureId() const
 {
@@ -485,20 +557,10 @@ void QTextureAtlas::upload(QTexture *texture)
         QPainter p(&tmp);
         p.setCompositionMode(QPainter::CompositionMode_Source);
 
-        int w = r.width();
-        int h = r.height();
         int iw = image.width();
         int ih = image.height();
 
-        p.drawImage(1, 1, image);
-        p.drawImage(1, 0, image, 0, 0, iw, 1);
-        p.drawImage(1, h - 1, image, 0, ih - 1, iw, 1);
-        p.drawImage(0, 1, image, 0, 0, 1, ih);
-        p.drawImage(w - 1, 1, image, iw - 1, 0, 1, ih);
-        p.drawImage(0, 0, image, 0, 0, 1, 1);
-        p.drawImage(0, h - 1, image, 0, ih - 1, 1, 1);
-        p.drawImage(w - 1, 0, image, iw - 1, 0, 1, 1);
-        p.drawImage(w - 1, h - 1, image, iw - 1, ih - 1, 1, 1);
+        drawPadded(p, image, QPoint(0, 0), r.size());
         if (m_debug_overlay) {
             p.setCompositionMode(QPainter::CompositionMode_SourceAtop);
             p.fillRect(0, 0, iw, ih, QBrush(QColor::fromRgbF(1, 0, 1, 0.5)));
@@ -630,6 +692,15 @@ void QTextureAtlas::bind(QOpenGLTexture::Filter filtering)
     if (m_texture_id == 0)
         return;
 
+    // Upload the prebuilt atlas..
+    if (!m_pending_image.isNull()) {
+        QImage image = m_pending_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        if (m_externalFormat == GL_RGBA)
+            swizzleBGRAToRGBA(&image);
+        funcs->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(), m_externalFormat, GL_UNSIGNED_BYTE, image.constBits());
+        m_pending_image = QImage();
+    }
+
     // Upload all pending images..
     for (int i=0; i<m_pending_uploads.size(); ++i) {
         QTexture *t = m_pending_uploads.at(i);
@@ -91,8 +91,12 @@ public:
     void uploadBgra(QTexture *texture);
 
     QTexture *create(const QImage &image);
+    QTexture *create(const QSize &size);
     void remove(QTexture *t);
 
+    void setImage(const QImage &image);
+    QImage toImage() const;
+
     QSize size() const { return m_size; }
 
     uint internalFormat() const { return m_internalFormat; }
@@ -103,6 +107,7 @@ private:
     unsigned int m_texture_id;
     QSize m_size;
     QList<QTexture *> m_pending_uploads;
+    QImage m_pending_image;
 
     uint m_internalFormat;
     uint m_externalFormat;
@@ -137,6 +142,13 @@ public:
 
     QTexture *create(const QImage &image);
 
+    // prebuilt atlas: the textures are allocated in the same order with their sizes only
+    // and the atlas image, with all of their pixels, is uploaded at once
+    QTexture *create(const QSize &size);
+    void setAtlasImage(const QImage &image);
+    // the pixels of the textures not uploaded yet, null once the atlas was uploaded
+    QImage atlasImage() const;
+
     quint32 atlasTextureId() const;
     QSize atlasTextureSize() const;
     int atlasTextureSizeLimit() const { return m_atlas_size_limit; }
@@ -28,17 +28,25 @@ SOURCES += \
     ../../ext/gl_util.cpp \
     ../TLFXAnimImage.cpp \
     ../TLFXAttributeNode.cpp \
+    ../TLFXCompiledLibrary.cpp \
     ../TLFXEffect.cpp \
     ../TLFXEffectsLibrary.cpp \
     ../TLFXEmitter.cpp \
     ../TLFXEmitterArray.cpp \
+    ../TLFXEmitterTable.cpp \
     ../TLFXEntity.cpp \
+    ../TLFXKernels.cpp \
+    ../TLFXMappedFile.cpp \
+    ../TLFXMath.cpp \
     ../TLFXMatrix2.cpp \
     ../TLFXParticle.cpp \
     ../TLFXParticleManager.cpp \
     ../TLFXPugiXMLLoader.cpp \
+    ../TLFXRandom.cpp \
+    ../TLFXTaskPool.cpp \
     ../TLFXVector2.cpp \
     ../TLFXXMLLoader.cpp \
+    ../TLFXZipArchive.cpp \
     QtEffectsLibrary.cpp \
     main.cpp
 
@@ -52,17 +60,26 @@ HEADERS += \
     ../../ext/gl_util.h \
     ../TLFXAnimImage.h \
     ../TLFXAttributeNode.h \
+    ../TLFXCompiledLibrary.h \
     ../TLFXEffect.h \
     ../TLFXEffectsLibrary.h \
     ../TLFXEmitter.h \
     ../TLFXEmitterArray.h \
+    ../TLFXEmitterTable.h \
     ../TLFXEntity.h \
+    ../TLFXKernels.h \
+    ../TLFXMappedFile.h \
+    ../TLFXMath.h \
     ../TLFXMatrix2.h \
+    ../TLFXNodeAllocator.h \
     ../TLFXParticle.h \
     ../TLFXParticleManager.h \
     ../TLFXPugiXMLLoader.h \
+    ../TLFXRandom.h \
+    ../TLFXTaskPool.h \
     ../TLFXVector2.h \
     ../TLFXXMLLoader.h \
+    ../TLFXZipArchive.h \
     QtEffectsLibrary.h
 
 include(qgeometry/qgeometry.pri)
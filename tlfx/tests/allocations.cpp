@@ -0,0 +1,90 @@
+/*
+ * Steady state allocation test: once every effect of the library has been running for a while, updating and drawing them must not
+ * allocate any more, even though particles keep being spawned and retired. The measured ticks run until 100000 particles have been
+ * spawned (see ParticleManager::GetGrabCounter). With --threads the effects are updated in parallel (see
+ * ParticleManager::SetUpdateThreads), which also checks that the nodes released on another thread than the one that took them are
+ * reused (see NodeFreeList).
+ *
+ * tlfx-test-allocations [--threads N] [data.xml]
+ */
+
+#include "TLFXNullEffectsLibrary.h"
+#include "TLFXEffect.h"
+#include "counting_new.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef TLFX_DATA_DIR
+#define TLFX_DATA_DIR "data/particles"
+#endif
+
+static const int warmUpTicks = 500;     // long enough for the pools and the scratch buffers of the emitters to reach their peak
+static const int spawnTarget = 100000;
+static const int maxTicks = 20000;
+
+int main(int argc, char **argv)
+{
+    const char *data = TLFX_DATA_DIR "/data.xml";
+    int threads = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else
+            data = argv[i];
+    }
+
+    TLFX::NullEffectsLibrary lib;
+    if (!lib.Load(data))
+    {
+        fprintf(stderr, "[tlfx-test-allocations] Cannot load %s\n", data);
+        return 1;
+    }
+
+    TLFX::NullParticleManager pm(TLFX::ParticleManager::particleLimit * 10, 1);
+    pm.SetScreenSize(800, 600);
+    pm.SetUpdateThreads(threads);
+    for (size_t i = 0; i < lib.AllEffects().size(); ++i)
+    {
+        TLFX::Effect *effect = lib.GetEffect(lib.AllEffects()[i].c_str());
+        if (!effect || effect->GetParentEmitter())     // sub effects are spawned by their parents
+            continue;
+        pm.AddEffect(new TLFX::Effect(*effect, &pm));
+    }
+
+    for (int t = 0; t < warmUpTicks; ++t)
+    {
+        pm.Update();
+        pm.DrawParticles();
+    }
+
+    pm.ResetPoolCounters();
+    unsigned long long allocations = GetAllocationCount();
+    int ticks = 0;
+    while (pm.GetGrabCounter() < spawnTarget && ticks < maxTicks)
+    {
+        pm.Update();
+        pm.DrawParticles();
+        ++ticks;
+    }
+    allocations = GetAllocationCount() - allocations;
+    int spawned = pm.GetGrabCounter();
+
+    printf("[tlfx-test-allocations] %d effects, %d threads, %d particles spawned, %llu allocations in %d ticks after %d ticks of warm-up\n",
+           pm.GetEffectCount(), threads, spawned, allocations, ticks, warmUpTicks);
+
+    pm.Destroy();
+    if (spawned < spawnTarget)
+    {
+        fprintf(stderr, "[tlfx-test-allocations] FAILED: only %d particles were spawned in %d ticks\n", spawned, maxTicks);
+        return 1;
+    }
+    if (allocations != 0)
+    {
+        fprintf(stderr, "[tlfx-test-allocations] FAILED: the steady state allocated\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#ifndef _TLFX_COUNTING_NEW_H
+#define _TLFX_COUNTING_NEW_H
+
+/*
+ * Replaces the global operator new and delete of the executable it is linked into with versions that count every allocation,
+ * for the allocation test and tlfx-bench. Link counting_new.cpp into the executable and read the count here.
+ */
+
+/**
+ * Get the number of operator new and new[] calls of the process so far, from all threads
+ */
+unsigned long long GetAllocationCount();
+
+#endif // _TLFX_COUNTING_NEW_H